@@ -851,6 +851,305 @@ DialogPage {
                 }
             }
 
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+
+                Label {
+                    Layout.fillWidth: true
+                    text: qsTr("Memory for inactive Speech to Text models (MB)")
+                    wrapMode: Text.Wrap
+                }
+
+                SpinBox {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? appWin.padding : 0
+                    from: 0
+                    to: 65536
+                    stepSize: 256
+                    value: _settings.stt_engine_pool_budget
+                    onValueChanged: {
+                        _settings.stt_engine_pool_budget = value;
+                    }
+                    Component.onCompleted: {
+                        contentItem.color = palette.text
+                    }
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("Recently used models are kept in memory, so switching back to them is instant.") + " " +
+                                  qsTr("Set to 0 to unload a model as soon as another one is used.")
+                }
+            }
+
+            CheckBox {
+                checked: _settings.whisper_adaptive_audio_ctx
+                text: qsTr("Adapt %1 audio context to speech length").arg("Whisper")
+                onCheckedChanged: {
+                    _settings.whisper_adaptive_audio_ctx = checked
+                }
+
+                ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                ToolTip.visible: hovered
+                ToolTip.text: qsTr("Speeds up decoding of short sentences and commands.") + " " +
+                              qsTr("Disable this option if you observe worse accuracy of the speech recognition.")
+            }
+
+            CheckBox {
+                checked: _settings.whisper_streaming
+                text: qsTr("Show partial results during %1 speech recognition").arg("Whisper")
+                onCheckedChanged: {
+                    _settings.whisper_streaming = checked
+                }
+
+                ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                ToolTip.visible: hovered
+                ToolTip.text: qsTr("Speech is decoded periodically while you are speaking and the text is updated in real time.") + " " +
+                              qsTr("This option significantly increases CPU usage.")
+            }
+
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+                visible: _settings.whisper_streaming
+
+                Label {
+                    Layout.fillWidth: true
+                    text: qsTr("Partial results interval (ms)")
+                    wrapMode: Text.Wrap
+                }
+
+                SpinBox {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? appWin.padding : 0
+                    from: 200
+                    to: 5000
+                    stepSize: 100
+                    value: _settings.whisper_streaming_interval
+                    onValueChanged: {
+                        _settings.whisper_streaming_interval = value;
+                    }
+                    Component.onCompleted: {
+                        contentItem.color = palette.text
+                    }
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("How often speech is decoded to update partial results.")
+                }
+            }
+
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+
+                Label {
+                    Layout.fillWidth: true
+                    text: qsTr("%1 partial results interval (ms)").arg("Vosk")
+                    wrapMode: Text.Wrap
+                }
+
+                SpinBox {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? appWin.padding : 0
+                    from: 100
+                    to: 2000
+                    stepSize: 100
+                    value: _settings.vosk_partial_interval
+                    onValueChanged: {
+                        _settings.vosk_partial_interval = value;
+                    }
+                    Component.onCompleted: {
+                        contentItem.color = palette.text
+                    }
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("How often the text is updated while you are speaking.")
+                }
+            }
+
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+
+                Label {
+                    Layout.fillWidth: true
+                    text: qsTr("Voice activity detection")
+                }
+                ComboBox {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? appWin.padding : 0
+                    currentIndex: {
+                        switch(_settings.stt_vad_backend) {
+                        case Settings.VadWebrtc: return 0
+                        case Settings.VadSilero: return 1
+                        }
+                        return 0
+                    }
+                    model: [
+                        "WebRTC",
+                        "Silero"
+                    ]
+                    onActivated: {
+                        if (index === 0) {
+                            _settings.stt_vad_backend = Settings.VadWebrtc
+                        } else if (index === 1) {
+                            _settings.stt_vad_backend = Settings.VadSilero
+                        }
+                    }
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("Method used to detect speech in audio.") + " " +
+                                  qsTr("%1 makes fewer mistakes in noisy environment but uses more CPU.").arg("Silero")
+                }
+            }
+
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+                visible: _settings.stt_vad_backend === Settings.VadSilero
+
+                Label {
+                    Layout.fillWidth: true
+                    Layout.leftMargin: verticalMode ? appWin.padding : 2 * appWin.padding
+                    text: qsTr("%1 model file").arg("Silero")
+                }
+                TextField {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? 2 * appWin.padding : 0
+                    text: _settings.stt_vad_model_file
+                    placeholderText: "silero_vad.onnx"
+                    onTextChanged: _settings.stt_vad_model_file = text
+                    color: palette.text
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("When empty, file %1 is searched in the models directory.").arg("silero_vad.onnx") + " " +
+                                  qsTr("If the model can't be loaded, %1 is used.").arg("WebRTC")
+                }
+            }
+
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+
+                Label {
+                    Layout.fillWidth: true
+                    text: qsTr("Speech onset (ms)")
+                    wrapMode: Text.Wrap
+                }
+
+                SpinBox {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? appWin.padding : 0
+                    from: 90
+                    to: 1800
+                    stepSize: 30
+                    value: _settings.stt_vad_onset
+                    onValueChanged: {
+                        _settings.stt_vad_onset = value;
+                    }
+                    Component.onCompleted: {
+                        contentItem.color = palette.text
+                    }
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("Speech is detected when it fills most of this time window.") + " " +
+                                  qsTr("Longer time reduces false detections of short noises.")
+                }
+            }
+
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+
+                Label {
+                    Layout.fillWidth: true
+                    text: qsTr("Speech end silence (ms)")
+                    wrapMode: Text.Wrap
+                }
+
+                SpinBox {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? appWin.padding : 0
+                    from: 90
+                    to: 3000
+                    stepSize: 30
+                    value: _settings.stt_vad_hangover
+                    onValueChanged: {
+                        _settings.stt_vad_hangover = value;
+                    }
+                    Component.onCompleted: {
+                        contentItem.color = palette.text
+                    }
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("Duration of silence after which speech is considered finished in %1 and %2 modes.").arg("<i>" + qsTr("One sentence") + "</i>").arg("<i>" + qsTr("Press and hold") + "</i>") + " " +
+                                  qsTr("In %1 mode, at least %2 ms is used.").arg("<i>" + qsTr("Always on") + "</i>").arg(1500)
+                }
+            }
+
+            GridLayout {
+                columns: root.verticalMode ? 1 : 2
+                columnSpacing: appWin.padding
+                rowSpacing: appWin.padding
+
+                Label {
+                    Layout.fillWidth: true
+                    text: qsTr("Audio file resampling")
+                }
+                ComboBox {
+                    Layout.fillWidth: verticalMode
+                    Layout.preferredWidth: verticalMode ? grid.width : grid.width / 2
+                    Layout.leftMargin: verticalMode ? appWin.padding : 0
+                    currentIndex: {
+                        switch(_settings.resampler_quality) {
+                        case Settings.ResamplerFast: return 0
+                        case Settings.ResamplerMedium: return 1
+                        case Settings.ResamplerHigh: return 2
+                        }
+                        return 1
+                    }
+                    model: [
+                        qsTr("Fast"),
+                        qsTr("Balanced"),
+                        qsTr("High quality")
+                    ]
+                    onActivated: {
+                        if (index === 0) {
+                            _settings.resampler_quality = Settings.ResamplerFast
+                        } else if (index === 1) {
+                            _settings.resampler_quality = Settings.ResamplerMedium
+                        } else if (index === 2) {
+                            _settings.resampler_quality = Settings.ResamplerHigh
+                        }
+                    }
+
+                    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("Conversion of transcribed audio files to the sample rate of speech recognition models.") + " " +
+                                  qsTr("%1 uses a shorter resampling filter, with slightly lower accuracy.").arg("<i>" + qsTr("Fast") + "</i>")
+                }
+            }
+
             SectionLabel {
                 text: qsTr("Graphics card options")
             }
@@ -87,44 +87,30 @@ void april_engine::reset_impl() {
     m_result_prev_segment.clear();
 }
 
-void april_engine::push_inbuf_to_samples() {
-    auto end = m_in_buf.buf.cbegin();
-    std::advance(end, m_in_buf.size);
-    m_speech_buf.insert(m_speech_buf.end(), m_in_buf.buf.cbegin(), end);
-}
-
 stt_engine::samples_process_result_t april_engine::process_buff() {
-    if (!lock_buff_for_processing())
-        return samples_process_result_t::wait_for_samples;
+    auto segment = pop_segment();
+    if (!segment) return samples_process_result_t::wait_for_samples;
 
-    auto eof = m_in_buf.eof;
-    auto sof = m_in_buf.sof;
+    auto eof = segment->eof;
+    auto sof = segment->sof;
 
     LOGD("process samples buf: mode="
-         << m_config.speech_mode << ", in-buf size=" << m_in_buf.size
-         << ", speech-buf size=" << m_speech_buf.size() << ", sof=" << sof
-         << ", eof=" << eof);
+         << m_config.speech_mode << ", segment size="
+         << segment->samples.size() << ", speech-buf size="
+         << m_speech_buf.size() << ", sof=" << sof << ", eof=" << eof);
 
     if (sof) {
         m_speech_buf.clear();
         m_start_time.reset();
-        m_vad.reset();
         if (m_session) aas_flush(m_session);
         m_result.clear();
         m_result_prev_segment.clear();
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
-
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
-
-    m_in_buf.clear();
+    const auto& vad_buf = segment->samples;
 
     bool vad_status = !vad_buf.empty();
 
-    m_in_buf.clear();
-
     if (vad_status) {
         LOGD("vad: speech detected");
 
@@ -149,14 +135,14 @@ stt_engine::samples_process_result_t april_engine::process_buff() {
     }
 
     if (m_thread_exit_requested) {
-        free_buf();
         return samples_process_result_t::no_samples_needed;
     }
 
     auto final_decode = [&] {
         if (eof) return true;
         if (m_config.speech_mode != speech_mode_t::manual &&
-            m_intermediate_text && !m_intermediate_text->empty() && !vad_status)
+            m_intermediate_text && !m_intermediate_text->empty() &&
+            (!vad_status || segment->speech_end))
             return true;
         return false;
     }();
@@ -184,8 +170,6 @@ stt_engine::samples_process_result_t april_engine::process_buff() {
         m_config.speech_mode == speech_mode_t::automatic)
         set_speech_detection_status(speech_detection_status_t::no_speech);
 
-    free_buf();
-
     return samples_process_result_t::wait_for_samples;
 }
 
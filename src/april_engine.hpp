@@ -41,7 +41,6 @@ class april_engine : public stt_engine {
     void decode_speech(april_buf_t& buf, bool eof);
     void reset_impl() override;
     void start_processing_impl() override;
-    void push_inbuf_to_samples();
 
     static void decode_handler(void* user_data, AprilResultType result_type,
                                size_t size, const AprilToken* token);
@@ -0,0 +1,27 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <cstddef>
+#include <utility>
+
+/*
+ * Consumer of raw audio that lends its own memory, so producer can write
+ * samples in place. borrow_buf returns {nullptr, 0} when there is no free
+ * space. Samples written to borrowed buf are committed with return_buf.
+ */
+class audio_sink {
+   public:
+    virtual ~audio_sink() = default;
+    virtual std::pair<char*, size_t> borrow_buf() = 0;
+    virtual void return_buf(const char* buf, size_t size, bool sof,
+                            bool eof) = 0;
+};
+
+#endif  // AUDIO_SINK_H
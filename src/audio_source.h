@@ -10,6 +10,8 @@
 
 #include <QObject>
 
+#include "audio_sink.hpp"
+
 class audio_source : public QObject {
     Q_OBJECT
    public:
@@ -29,11 +31,15 @@ class audio_source : public QObject {
     virtual double progress() const { return -1; };
     virtual source_type type() const = 0;
     virtual void stop() = 0;
-    virtual void slowdown() = 0;
-    virtual void speedup() = 0;
+    // returns true if source writes audio directly to sink from its own
+    // thread, in that case read_audio is not used, nullptr detaches sink
+    virtual bool attach_sink([[maybe_unused]] audio_sink* sink) {
+        return false;
+    }
     ~audio_source() override = default;
 
    signals:
+    // emitted when new audio can be read, reading is driven by consumer
     void audio_available();
     void error();
     void ended();
@@ -8,14 +8,18 @@
 #include "coqui_engine.hpp"
 
 #include <fmt/format.h>
+#include <pybind11/numpy.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "logger.hpp"
 #include "py_executor.hpp"
@@ -250,7 +254,7 @@ void coqui_engine::create_model() {
 bool coqui_engine::model_created() const { return static_cast<bool>(m_model); }
 
 bool coqui_engine::encode_speech_impl(const std::string& text,
-                                      const std::string& out_file) {
+                                      pcm_sink& sink) {
     auto* pe = py_executor::instance();
 
     auto length_scale =
@@ -296,8 +300,27 @@ bool coqui_engine::encode_speech_impl(const std::string& text,
                              "style_text"_a = py::none(),
                              "reference_speaker_name"_a = py::none());
 
-                         m_model->attr("save_wav")("wav"_a = wav,
-                                                   "path"_a = out_file);
+                         // same normalization as in save_wav, samples are
+                         // converted in numpy instead of one by one
+                         auto np = py::module_::import("numpy");
+                         auto samples =
+                             np.attr("asarray")(wav, "dtype"_a = "float32");
+                         auto peak = std::max(
+                             0.01f,
+                             np.attr("max")(np.attr("abs")(samples))
+                                 .cast<float>());
+                         auto pcm =
+                             np.attr("multiply")(samples, 32767.0f / peak)
+                                 .attr("astype")("int16")
+                                 .cast<py::array_t<
+                                     int16_t, py::array::c_style |
+                                                  py::array::forcecast>>();
+
+                         sink.set_format(
+                             m_model->attr("output_sample_rate").cast<int>(),
+                             1);
+                         sink.write(pcm.data(),
+                                    static_cast<size_t>(pcm.size()));
                      } catch (const std::exception& err) {
                          LOGE("py error: " << err.what());
                          return std::string{"false"};
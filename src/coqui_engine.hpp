@@ -38,8 +38,7 @@ class coqui_engine : public tts_engine {
     bool model_created() const final;
     bool model_supports_speed() const final;
     void create_model() final;
-    bool encode_speech_impl(const std::string& text,
-                            const std::string& out_file) final;
+    bool encode_speech_impl(const std::string& text, pcm_sink& sink) final;
     void stop();
     static std::string fix_config_file(const std::string& config_file,
                                        const std::string& dir, bool vocoder);
@@ -11,6 +11,7 @@
 #include <array>
 #include <fstream>
 #include <iterator>
+#include <set>
 #include <string>
 #include <thread>
 
@@ -108,13 +109,13 @@ bool cpu_tools::avx_supported() {
 
 bool cpu_tools::avx_avx2_supported() {
     static const bool supported = [] {
-        std::array flags = {"avx", "avx2"};
-
         std::ifstream cpuinfo("/proc/cpuinfo");
-        return std::find_first_of(std::istream_iterator<std::string>{cpuinfo},
-                                  std::istream_iterator<std::string>{},
-                                  flags.cbegin(), flags.cend()) !=
-               std::istream_iterator<std::string>{};
+        const std::set<std::string> cpu_flags{
+            std::istream_iterator<std::string>{cpuinfo},
+            std::istream_iterator<std::string>{}};
+
+        // both are required, cpu with avx but without avx2 is common
+        return cpu_flags.count("avx") > 0 && cpu_flags.count("avx2") > 0;
     }();
 
     return supported;
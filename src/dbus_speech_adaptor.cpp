@@ -267,6 +267,14 @@ double SpeechAdaptor::SttGetFileTranscribeProgress(int task)
     return progress;
 }
 
+QVariantMap SpeechAdaptor::SttResultCacheStats()
+{
+    // handle method call org.mkiol.Speech.SttResultCacheStats
+    QVariantMap stats;
+    QMetaObject::invokeMethod(parent(), "SttResultCacheStats", Q_RETURN_ARG(QVariantMap, stats));
+    return stats;
+}
+
 int SpeechAdaptor::SttStartListen(int mode, const QString &lang, const QString &out_lang)
 {
     // handle method call org.mkiol.Speech.SttStartListen
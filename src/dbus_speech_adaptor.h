@@ -255,6 +255,10 @@ class SpeechAdaptor: public QDBusAbstractAdaptor
 "      <annotation value=\"QVariantMap\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
 "      <arg direction=\"out\" type=\"a{sv}\" name=\"features\"/>\n"
 "    </method>\n"
+"    <method name=\"SttResultCacheStats\">\n"
+"      <annotation value=\"QVariantMap\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
+"      <arg direction=\"out\" type=\"a{sv}\" name=\"stats\"/>\n"
+"    </method>\n"
 "    <signal name=\"FeaturesAvailabilityUpdated\"/>\n"
 "    <method name=\"Reload\">\n"
 "      <arg direction=\"out\" type=\"i\" name=\"result\"/>\n"
@@ -369,6 +373,7 @@ public Q_SLOTS: // METHODS
     int MntTranslate2(const QString &text, const QString &lang, const QString &out_lang, const QVariantMap &options);
     int Reload();
     double SttGetFileTranscribeProgress(int task);
+    QVariantMap SttResultCacheStats();
     int SttStartListen(int mode, const QString &lang, const QString &out_lang);
     int SttStopListen(int task);
     int SttTranscribeFile(const QString &file, const QString &lang, const QString &out_lang);
@@ -192,6 +192,12 @@ public Q_SLOTS: // METHODS
         return asyncCallWithArgumentList(QStringLiteral("SttGetFileTranscribeProgress"), argumentList);
     }
 
+    inline QDBusPendingReply<QVariantMap> SttResultCacheStats()
+    {
+        QList<QVariant> argumentList;
+        return asyncCallWithArgumentList(QStringLiteral("SttResultCacheStats"), argumentList);
+    }
+
     inline QDBusPendingReply<int> SttStartListen(int mode, const QString &lang, const QString &out_lang)
     {
         QList<QVariant> argumentList;
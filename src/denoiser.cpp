@@ -15,6 +15,7 @@ extern "C" {
 #include <cmath>
 #include <stdexcept>
 
+#include "dsp_tools.hpp"
 #include "logger.hpp"
 
 denoiser::denoiser(int sample_rate) {
@@ -38,20 +39,9 @@ void denoiser::normalize_audio(sample_t* audio, size_t size) {
     // inspired by https://github.com/fluffy-critter/AudioCompress
 
     int max = std::numeric_limits<sample_t>::max();
-    int min = std::numeric_limits<sample_t>::min();
     int target_gain = max * 0.75;
 
-    auto peak = [=] {
-        int peak = 1;
-
-        for (size_t i = 0; i < size; ++i) {
-            int val = audio[i];
-            if (val < 0) val = -val;
-            if (val > peak) peak = val;
-        }
-
-        return peak;
-    }();
+    auto peak = std::max(1, dsp_tools::peak(audio, size));
 
     auto new_gain = [=]() {
         int max_ampl = 32;
@@ -64,9 +54,7 @@ void denoiser::normalize_audio(sample_t* audio, size_t size) {
         return new_gain;
     }();
 
-    for (size_t i = 0; i < size; ++i)
-        audio[i] = static_cast<sample_t>(
-            std::clamp(audio[i] * new_gain >> 10, min, max));
+    dsp_tools::apply_gain_q10(audio, size, new_gain);
 }
 
 void denoiser::process_char(char* buf, size_t size) {
@@ -84,21 +72,22 @@ void denoiser::process(sample_t* buf, size_t size) {
         size_t samples = end - cur;
 
         if (samples >= frame.size()) {
-            for (size_t i = 0; i < frame.size(); ++i) frame[i] = cur[i];
             samples = frame.size();
         } else {
-            for (size_t i = 0; i < samples; ++i) frame[i] = cur[i];
-            for (size_t i = 0; i < frame.size() - samples; ++i) frame[i] = 0.0;
+            std::fill(frame.begin() + samples, frame.end(), 0.0F);
         }
 
+        // rnnoise works on floats in s16 range
+        dsp_tools::s16_to_f32(cur, frame.data(), samples, 1.0F);
+
         auto prob = rnnoise_process_frame(m_state, frame.data(), frame.data());
 
         LOGT("prob: " << prob);
 
         if (prob < 0.1)
-            for (size_t i = 0; i < samples; ++i) cur[i] = 0;
+            std::fill(cur, cur + samples, 0);
         else
-            for (size_t i = 0; i < samples; ++i) cur[i] = frame[i];
+            dsp_tools::f32_to_s16(frame.data(), cur, samples, 1.0F);
 
         cur += samples;
     }
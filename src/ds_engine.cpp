@@ -134,21 +134,20 @@ void ds_engine::reset_impl() {
 }
 
 stt_engine::samples_process_result_t ds_engine::process_buff() {
-    if (!lock_buff_for_processing())
-        return samples_process_result_t::wait_for_samples;
+    auto segment = pop_segment();
+    if (!segment) return samples_process_result_t::wait_for_samples;
 
-    auto eof = m_in_buf.eof;
-    auto sof = m_in_buf.sof;
+    auto eof = segment->eof;
+    auto sof = segment->sof;
 
     LOGD("process samples buf: mode="
-         << m_config.speech_mode << ", in-buf size=" << m_in_buf.size
-         << ", speech-buf size=" << m_speech_buf.size() << ", sof=" << sof
-         << ", eof=" << eof);
+         << m_config.speech_mode << ", segment size="
+         << segment->samples.size() << ", speech-buf size="
+         << m_speech_buf.size() << ", sof=" << sof << ", eof=" << eof);
 
     if (sof) {
         m_speech_buf.clear();
         m_start_time.reset();
-        m_vad.reset();
 
         free_ds_stream();
         create_ds_stream();
@@ -157,17 +156,10 @@ stt_engine::samples_process_result_t ds_engine::process_buff() {
         m_decoded_samples = 0;
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
-
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
-
-    m_in_buf.clear();
+    const auto& vad_buf = segment->samples;
 
     bool vad_status = !vad_buf.empty();
 
-    m_in_buf.clear();
-
     if (vad_status) {
         LOGD("vad: speech detected");
 
@@ -192,14 +184,14 @@ stt_engine::samples_process_result_t ds_engine::process_buff() {
     }
 
     if (m_thread_exit_requested) {
-        free_buf();
         return samples_process_result_t::no_samples_needed;
     }
 
     auto final_decode = [&] {
         if (eof) return true;
         if (m_config.speech_mode != speech_mode_t::manual &&
-            m_intermediate_text && !m_intermediate_text->empty() && !vad_status)
+            m_intermediate_text && !m_intermediate_text->empty() &&
+            (!vad_status || segment->speech_end))
             return true;
         return false;
     }();
@@ -228,8 +220,6 @@ stt_engine::samples_process_result_t ds_engine::process_buff() {
         m_config.speech_mode == speech_mode_t::automatic)
         set_speech_detection_status(speech_detection_status_t::no_speech);
 
-    free_buf();
-
     return samples_process_result_t::wait_for_samples;
 }
 
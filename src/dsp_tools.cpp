@@ -0,0 +1,415 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "dsp_tools.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "cpu_tools.hpp"
+#include "logger.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DSP_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define DSP_NEON
+#include <arm_neon.h>
+#endif
+
+std::ostream& dsp_tools::operator<<(std::ostream& os, simd_t simd) {
+    switch (simd) {
+        case dsp_tools::simd_t::none:
+            os << "none";
+            break;
+        case dsp_tools::simd_t::sse2:
+            os << "sse2";
+            break;
+        case dsp_tools::simd_t::avx2:
+            os << "avx2";
+            break;
+        case dsp_tools::simd_t::neon:
+            os << "neon";
+            break;
+    }
+
+    return os;
+}
+
+static constexpr float s16_min =
+    static_cast<float>(std::numeric_limits<int16_t>::min());
+static constexpr float s16_max =
+    static_cast<float>(std::numeric_limits<int16_t>::max());
+
+static void s16_to_f32_scalar(const int16_t* input, float* output, size_t size,
+                              float scale) {
+    for (size_t i = 0; i < size; ++i)
+        output[i] = static_cast<float>(input[i]) * scale;
+}
+
+static void f32_to_s16_scalar(const float* input, int16_t* output, size_t size,
+                              float scale) {
+    for (size_t i = 0; i < size; ++i)
+        output[i] = static_cast<int16_t>(
+            std::clamp(input[i] * scale, s16_min, s16_max));
+}
+
+static void min_max_scalar(const int16_t* input, size_t size, int& min,
+                           int& max) {
+    for (size_t i = 0; i < size; ++i) {
+        min = std::min<int>(min, input[i]);
+        max = std::max<int>(max, input[i]);
+    }
+}
+
+static int peak_scalar(const int16_t* input, size_t size) {
+    int min = 0, max = 0;
+    min_max_scalar(input, size, min, max);
+    return std::max(max, -min);
+}
+
+static void apply_gain_q10_scalar(int16_t* buf, size_t size, int gain) {
+    for (size_t i = 0; i < size; ++i)
+        buf[i] = static_cast<int16_t>(
+            std::clamp(buf[i] * gain >> 10,
+                       static_cast<int>(std::numeric_limits<int16_t>::min()),
+                       static_cast<int>(std::numeric_limits<int16_t>::max())));
+}
+
+#ifdef DSP_X86
+static void s16_to_f32_sse2(const int16_t* input, float* output, size_t size,
+                            float scale) {
+    const auto vscale = _mm_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto s16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        // sign extension by arithmetic shift of duplicated words
+        auto lo = _mm_srai_epi32(_mm_unpacklo_epi16(s16, s16), 16);
+        auto hi = _mm_srai_epi32(_mm_unpackhi_epi16(s16, s16), 16);
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(output + i + 4,
+                      _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+
+    s16_to_f32_scalar(input + i, output + i, size - i, scale);
+}
+
+static void f32_to_s16_sse2(const float* input, int16_t* output, size_t size,
+                            float scale) {
+    const auto vscale = _mm_set1_ps(scale);
+    const auto vmin = _mm_set1_ps(s16_min);
+    const auto vmax = _mm_set1_ps(s16_max);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto lo = _mm_mul_ps(_mm_loadu_ps(input + i), vscale);
+        auto hi = _mm_mul_ps(_mm_loadu_ps(input + i + 4), vscale);
+        lo = _mm_min_ps(_mm_max_ps(lo, vmin), vmax);
+        hi = _mm_min_ps(_mm_max_ps(hi, vmin), vmax);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+                         _mm_packs_epi32(_mm_cvttps_epi32(lo),
+                                         _mm_cvttps_epi32(hi)));
+    }
+
+    f32_to_s16_scalar(input + i, output + i, size - i, scale);
+}
+
+static int peak_sse2(const int16_t* input, size_t size) {
+    auto vmin = _mm_setzero_si128();
+    auto vmax = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto s16 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        vmin = _mm_min_epi16(vmin, s16);
+        vmax = _mm_max_epi16(vmax, s16);
+    }
+
+    alignas(16) int16_t mins[8];
+    alignas(16) int16_t maxs[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(mins), vmin);
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxs), vmax);
+
+    int min = *std::min_element(mins, mins + 8);
+    int max = *std::max_element(maxs, maxs + 8);
+    min_max_scalar(input + i, size - i, min, max);
+
+    return std::max(max, -min);
+}
+
+__attribute__((target("avx2"))) static void s16_to_f32_avx2(
+    const int16_t* input, float* output, size_t size, float scale) {
+    const auto vscale = _mm256_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto lo = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)));
+        auto hi = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8)));
+        _mm256_storeu_ps(output + i,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(lo), vscale));
+        _mm256_storeu_ps(output + i + 8,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(hi), vscale));
+    }
+
+    s16_to_f32_scalar(input + i, output + i, size - i, scale);
+}
+
+__attribute__((target("avx2"))) static void f32_to_s16_avx2(
+    const float* input, int16_t* output, size_t size, float scale) {
+    const auto vscale = _mm256_set1_ps(scale);
+    const auto vmin = _mm256_set1_ps(s16_min);
+    const auto vmax = _mm256_set1_ps(s16_max);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto lo = _mm256_mul_ps(_mm256_loadu_ps(input + i), vscale);
+        auto hi = _mm256_mul_ps(_mm256_loadu_ps(input + i + 8), vscale);
+        lo = _mm256_min_ps(_mm256_max_ps(lo, vmin), vmax);
+        hi = _mm256_min_ps(_mm256_max_ps(hi, vmin), vmax);
+        // pack works within 128-bit lanes, permute restores order
+        auto s16 = _mm256_permute4x64_epi64(
+            _mm256_packs_epi32(_mm256_cvttps_epi32(lo),
+                               _mm256_cvttps_epi32(hi)),
+            0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), s16);
+    }
+
+    f32_to_s16_scalar(input + i, output + i, size - i, scale);
+}
+
+__attribute__((target("avx2"))) static int peak_avx2(const int16_t* input,
+                                                     size_t size) {
+    auto vmin = _mm256_setzero_si256();
+    auto vmax = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto s16 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        vmin = _mm256_min_epi16(vmin, s16);
+        vmax = _mm256_max_epi16(vmax, s16);
+    }
+
+    alignas(32) int16_t mins[16];
+    alignas(32) int16_t maxs[16];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(mins), vmin);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(maxs), vmax);
+
+    int min = *std::min_element(mins, mins + 16);
+    int max = *std::max_element(maxs, maxs + 16);
+    min_max_scalar(input + i, size - i, min, max);
+
+    return std::max(max, -min);
+}
+
+__attribute__((target("avx2"))) static void apply_gain_q10_avx2(
+    int16_t* buf, size_t size, int gain) {
+    const auto vgain = _mm256_set1_epi32(gain);
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        auto lo = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i)));
+        auto hi = _mm256_cvtepi16_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i + 8)));
+        lo = _mm256_srai_epi32(_mm256_mullo_epi32(lo, vgain), 10);
+        hi = _mm256_srai_epi32(_mm256_mullo_epi32(hi, vgain), 10);
+        auto s16 =
+            _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf + i), s16);
+    }
+
+    apply_gain_q10_scalar(buf + i, size - i, gain);
+}
+#endif  // DSP_X86
+
+#ifdef DSP_NEON
+static void s16_to_f32_neon(const int16_t* input, float* output, size_t size,
+                            float scale) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto s16 = vld1q_s16(input + i);
+        vst1q_f32(output + i,
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s16))),
+                              scale));
+        vst1q_f32(output + i + 4,
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s16))),
+                              scale));
+    }
+
+    s16_to_f32_scalar(input + i, output + i, size - i, scale);
+}
+
+static void f32_to_s16_neon(const float* input, int16_t* output, size_t size,
+                            float scale) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        // float to int conversion and narrowing both saturate
+        auto lo = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i), scale));
+        auto hi = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(input + i + 4), scale));
+        vst1q_s16(output + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+
+    f32_to_s16_scalar(input + i, output + i, size - i, scale);
+}
+
+static int peak_neon(const int16_t* input, size_t size) {
+    auto vmin = vdupq_n_s16(0);
+    auto vmax = vdupq_n_s16(0);
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto s16 = vld1q_s16(input + i);
+        vmin = vminq_s16(vmin, s16);
+        vmax = vmaxq_s16(vmax, s16);
+    }
+
+    int min = vminvq_s16(vmin);
+    int max = vmaxvq_s16(vmax);
+    min_max_scalar(input + i, size - i, min, max);
+
+    return std::max(max, -min);
+}
+
+static void apply_gain_q10_neon(int16_t* buf, size_t size, int gain) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        auto s16 = vld1q_s16(buf + i);
+        auto lo = vshrq_n_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(s16)), gain),
+                              10);
+        auto hi = vshrq_n_s32(
+            vmulq_n_s32(vmovl_s16(vget_high_s16(s16)), gain), 10);
+        vst1q_s16(buf + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+
+    apply_gain_q10_scalar(buf + i, size - i, gain);
+}
+#endif  // DSP_NEON
+
+namespace {
+struct kernels_t {
+    dsp_tools::simd_t simd = dsp_tools::simd_t::none;
+    decltype(&s16_to_f32_scalar) s16_to_f32 = s16_to_f32_scalar;
+    decltype(&f32_to_s16_scalar) f32_to_s16 = f32_to_s16_scalar;
+    decltype(&peak_scalar) peak = peak_scalar;
+    decltype(&apply_gain_q10_scalar) apply_gain_q10 = apply_gain_q10_scalar;
+};
+
+kernels_t make_kernels(dsp_tools::simd_t simd) {
+    kernels_t kernels;
+    kernels.simd = simd;
+
+    switch (simd) {
+        case dsp_tools::simd_t::none:
+            break;
+        case dsp_tools::simd_t::sse2:
+#ifdef DSP_X86
+            kernels.s16_to_f32 = s16_to_f32_sse2;
+            kernels.f32_to_s16 = f32_to_s16_sse2;
+            kernels.peak = peak_sse2;
+#endif
+            break;
+        case dsp_tools::simd_t::avx2:
+#ifdef DSP_X86
+            kernels.s16_to_f32 = s16_to_f32_avx2;
+            kernels.f32_to_s16 = f32_to_s16_avx2;
+            kernels.peak = peak_avx2;
+            kernels.apply_gain_q10 = apply_gain_q10_avx2;
+#endif
+            break;
+        case dsp_tools::simd_t::neon:
+#ifdef DSP_NEON
+            kernels.s16_to_f32 = s16_to_f32_neon;
+            kernels.f32_to_s16 = f32_to_s16_neon;
+            kernels.peak = peak_neon;
+            kernels.apply_gain_q10 = apply_gain_q10_neon;
+#endif
+            break;
+    }
+
+    return kernels;
+}
+
+kernels_t& kernels() {
+    static kernels_t kernels = [] {
+        auto simd = dsp_tools::simd_t::none;
+
+        if (dsp_tools::simd_supported(dsp_tools::simd_t::avx2))
+            simd = dsp_tools::simd_t::avx2;
+        else if (dsp_tools::simd_supported(dsp_tools::simd_t::neon))
+            simd = dsp_tools::simd_t::neon;
+        else if (dsp_tools::simd_supported(dsp_tools::simd_t::sse2))
+            simd = dsp_tools::simd_t::sse2;
+
+        LOGD("dsp simd: " << simd);
+
+        return make_kernels(simd);
+    }();
+
+    return kernels;
+}
+}  // namespace
+
+bool dsp_tools::simd_supported(simd_t value) {
+    switch (value) {
+        case simd_t::none:
+            return true;
+        case simd_t::sse2:
+#ifdef DSP_X86
+            return true;
+#else
+            return false;
+#endif
+        case simd_t::avx2:
+#ifdef DSP_X86
+            return cpu_tools::avx_avx2_supported();
+#else
+            return false;
+#endif
+        case simd_t::neon:
+#ifdef DSP_NEON
+            return cpu_tools::neon_supported();
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+dsp_tools::simd_t dsp_tools::simd() { return kernels().simd; }
+
+bool dsp_tools::set_simd(simd_t value) {
+    if (!simd_supported(value)) return false;
+
+    kernels() = make_kernels(value);
+
+    return true;
+}
+
+void dsp_tools::s16_to_f32(const int16_t* input, float* output, size_t size,
+                           float scale) {
+    kernels().s16_to_f32(input, output, size, scale);
+}
+
+void dsp_tools::f32_to_s16(const float* input, int16_t* output, size_t size,
+                           float scale) {
+    kernels().f32_to_s16(input, output, size, scale);
+}
+
+int dsp_tools::peak(const int16_t* input, size_t size) {
+    return kernels().peak(input, size);
+}
+
+void dsp_tools::apply_gain_q10(int16_t* buf, size_t size, int gain) {
+    kernels().apply_gain_q10(buf, size, gain);
+}
@@ -0,0 +1,41 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef DSP_TOOLS_H
+#define DSP_TOOLS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+/*
+ * Sample format kernels. Vectorized variant is selected at runtime
+ * with cpu_tools, scalar one is used when no SIMD extension is available.
+ */
+namespace dsp_tools {
+enum class simd_t { none, sse2, avx2, neon };
+
+simd_t simd();
+// switches kernels variant, returns false when cpu doesn't support it
+bool set_simd(simd_t value);
+bool simd_supported(simd_t value);
+
+// output = input * scale
+void s16_to_f32(const int16_t* input, float* output, size_t size,
+                float scale = 1.0F / 32768.0F);
+// output = input * scale, truncated and saturated to int16 range
+void f32_to_s16(const float* input, int16_t* output, size_t size,
+                float scale = 32768.0F);
+// max absolute value of samples
+int peak(const int16_t* input, size_t size);
+// buf = buf * gain >> 10, saturated to int16 range
+void apply_gain_q10(int16_t* buf, size_t size, int gain);
+
+std::ostream& operator<<(std::ostream& os, simd_t simd);
+}  // namespace dsp_tools
+
+#endif  // DSP_TOOLS_H
@@ -66,7 +66,7 @@ void espeak_engine::create_model() {
 
 struct callback_data {
     espeak_engine* engine = nullptr;
-    std::ofstream wav_file;
+    tts_engine::pcm_sink* sink = nullptr;
 };
 
 int espeak_engine::synth_callback(short* wav, int size, espeak_EVENT* event) {
@@ -82,7 +82,7 @@ int espeak_engine::synth_callback(short* wav, int size, espeak_EVENT* event) {
         return 1;
     }
 
-    cb_data->wav_file.write(reinterpret_cast<char*>(wav), size * sizeof(short));
+    cb_data->sink->write(wav, size);
 
     return 0;
 }
@@ -90,7 +90,7 @@ int espeak_engine::synth_callback(short* wav, int size, espeak_EVENT* event) {
 bool espeak_engine::model_supports_speed() const { return true; }
 
 bool espeak_engine::encode_speech_impl(const std::string& text,
-                                       const std::string& out_file) {
+                                       pcm_sink& sink) {
     auto rate = [this]() {
         auto default_rate = espeak_GetParameter(espeakRATE, 0);
 
@@ -107,51 +107,24 @@ bool espeak_engine::encode_speech_impl(const std::string& text,
 
     espeak_SetParameter(espeakRATE, rate, 0);
 
-    callback_data cb_data{this, std::ofstream{out_file, std::ios::binary}};
+    callback_data cb_data{this, &sink};
 
     espeak_SetSynthCallback(&synth_callback);
 
-    if (cb_data.wav_file.bad()) {
-        LOGE("failed to open file for writting: " << out_file);
-        return false;
-    }
-
-    cb_data.wav_file.seekp(sizeof(wav_header));
+    sink.set_format(m_sample_rate, 1);
 
     if (espeak_Synth(text.c_str(), text.size(), 0, POS_CHARACTER,
                      espeakCHARS_AUTO, 0, nullptr, &cb_data) != EE_OK) {
         LOGE("error in espeak synth");
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
         return false;
     }
 
     if (espeak_Synchronize() != EE_OK) {
         LOGE("error in espeak synchronize");
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
-        return false;
-    }
-
-    if (m_shutting_down) {
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
         return false;
     }
 
-    auto data_size = cb_data.wav_file.tellp();
-
-    if (data_size == sizeof(wav_header)) {
-        LOGE("no audio data");
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
-        return false;
-    }
-
-    cb_data.wav_file.seekp(0);
-
-    write_wav_header(m_sample_rate, sizeof(short), 1, data_size / sizeof(short),
-                     cb_data.wav_file);
+    if (m_shutting_down) return false;
 
     LOGD("voice synthesized successfully");
 
@@ -27,8 +27,7 @@ class espeak_engine : public tts_engine {
     bool model_created() const final;
     bool model_supports_speed() const final;
     void create_model() final;
-    bool encode_speech_impl(const std::string& text,
-                            const std::string& out_file) final;
+    bool encode_speech_impl(const std::string& text, pcm_sink& sink) final;
     static int synth_callback(short* wav, int size, espeak_EVENT* event);
 };
 
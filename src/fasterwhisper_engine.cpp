@@ -12,13 +12,17 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
-#include <sstream>
+#include <optional>
+#include <utility>
 
 #include "cpu_tools.hpp"
+#include "dsp_tools.hpp"
 #include "gpu_tools.hpp"
 #include "logger.hpp"
 #include "py_executor.hpp"
+#include "thread_tuner.hpp"
 
 using namespace pybind11::literals;
 
@@ -59,11 +63,9 @@ void fasterwhisper_engine::push_buf_to_whisper_buf(
     const std::vector<in_buf_t::buf_t::value_type>& buf,
     whisper_buf_t& whisper_buf) {
     // convert s16 to f32 sample format
-    std::transform(buf.cbegin(), buf.cend(), std::back_inserter(whisper_buf),
-                   [](auto sample) {
-                       return static_cast<whisper_buf_t::value_type>(sample) /
-                              32768.0F;
-                   });
+    auto offset = whisper_buf.size();
+    whisper_buf.resize(offset + buf.size());
+    dsp_tools::s16_to_f32(buf.data(), whisper_buf.data() + offset, buf.size());
 }
 
 void fasterwhisper_engine::reset_impl() { m_speech_buf.clear(); }
@@ -86,10 +88,6 @@ void fasterwhisper_engine::create_model() {
 
     try {
         ok = pe->execute([&]() {
-                   auto n_threads = std::min(
-                       m_threads,
-                       std::max(1, static_cast<int>(
-                                       std::thread::hardware_concurrency())));
                    auto use_cuda = m_config.use_gpu &&
                                    m_config.gpu_device.api == gpu_api_t::cuda &&
                                    gpu_tools::has_cudnn();
@@ -97,23 +95,68 @@ void fasterwhisper_engine::create_model() {
                    LOGD("cpu info: arch="
                         << cpu_tools::arch()
                         << ", cores=" << std::thread::hardware_concurrency());
-                   LOGD("using threads: "
-                        << n_threads << "/"
-                        << std::thread::hardware_concurrency());
                    LOGD("using device: " << (use_cuda ? "cuda" : "cpu") << " "
                                          << m_config.gpu_device.id);
 
                    try {
                        auto fw = py::module_::import("faster_whisper");
 
-                       m_model.emplace(fw.attr("WhisperModel")(
-                           "model_size_or_path"_a =
-                               m_config.model_files.model_file,
-                           "device"_a = use_cuda ? "cuda" : "cpu",
-                           "device_index"_a =
-                               use_cuda ? m_config.gpu_device.id : 0,
-                           "local_files_only"_a = true,
-                           "cpu_threads"_a = n_threads));
+                       auto make_model = [&](int n_threads) {
+                           return fw.attr("WhisperModel")(
+                               "model_size_or_path"_a =
+                                   m_config.model_files.model_file,
+                               "device"_a = use_cuda ? "cuda" : "cpu",
+                               "device_index"_a =
+                                   use_cuda ? m_config.gpu_device.id : 0,
+                               "local_files_only"_a = true,
+                               "cpu_threads"_a = n_threads);
+                       };
+
+                       auto n_threads = std::min(
+                           m_threads,
+                           std::max(1, static_cast<int>(
+                                           std::thread::hardware_concurrency())));
+
+                       // number of threads is fixed when model is loaded,
+                       // last loaded model is reused if it has the best one
+                       std::optional<std::pair<int, py::object>> bench_model;
+
+                       if (!use_cuda) {
+                           n_threads = thread_tuner::instance()->threads(
+                               m_config.model_files.model_file, n_threads,
+                               [&](int threads) {
+                                   if (bench_model &&
+                                       bench_model->first == threads)
+                                       return true;
+
+                                   // previous model is freed before loading
+                                   bench_model.reset();
+
+                                   try {
+                                       bench_model.emplace(threads,
+                                                           make_model(threads));
+                                   } catch (const std::exception& err) {
+                                       LOGE("py error: " << err.what());
+                                       return false;
+                                   }
+
+                                   return true;
+                               },
+                               [&]([[maybe_unused]] int threads) {
+                                   return bench_threads(bench_model->second);
+                               });
+                       }
+
+                       LOGD("using threads: "
+                            << n_threads << "/"
+                            << std::thread::hardware_concurrency());
+
+                       if (bench_model && bench_model->first == n_threads) {
+                           m_model.emplace(std::move(bench_model->second));
+                       } else {
+                           bench_model.reset();
+                           m_model.emplace(make_model(n_threads));
+                       }
                    } catch (const std::exception& err) {
                        LOGE("py error: " << err.what());
                        m_model.reset();
@@ -130,30 +173,48 @@ void fasterwhisper_engine::create_model() {
     LOGD("fasterwhisper model created");
 }
 
+bool fasterwhisper_engine::bench_threads(const py::object& model) {
+    try {
+        // 2s of quiet synthetic tone
+        py::array_t<float> array(m_sample_rate * 2);
+        auto r = array.mutable_unchecked<1>();
+        for (py::ssize_t i = 0; i < r.shape(0); ++i)
+            r(i) = 0.01F * std::sin(static_cast<float>(i) * 0.05F);
+
+        auto seg_tuple = model.attr("transcribe")(
+            "audio"_a = array, "beam_size"_a = 5, "language"_a = m_config.lang);
+
+        // segments are decoded lazily while iterating
+        auto py_segments = *seg_tuple.cast<py::list>().begin();
+        for ([[maybe_unused]] auto& segment : py_segments)
+            ;
+    } catch (const std::exception& err) {
+        LOGE("fasterwhisper py error: " << err.what());
+        return false;
+    }
+
+    return true;
+}
+
 stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
-    if (!lock_buff_for_processing())
-        return samples_process_result_t::wait_for_samples;
+    auto segment = pop_segment();
+    if (!segment) return samples_process_result_t::wait_for_samples;
 
-    auto eof = m_in_buf.eof;
-    auto sof = m_in_buf.sof;
+    auto eof = segment->eof;
+    auto sof = segment->sof;
 
     LOGD("process samples buf: mode="
-         << m_config.speech_mode << ", in-buf size=" << m_in_buf.size
-         << ", speech-buf size=" << m_speech_buf.size() << ", sof=" << sof
-         << ", eof=" << eof);
+         << m_config.speech_mode << ", segment size="
+         << segment->samples.size() << ", speech-buf size="
+         << m_speech_buf.size() << ", sof=" << sof << ", eof=" << eof);
 
     if (sof) {
         m_speech_buf.clear();
+        m_streaming.reset();
         m_start_time.reset();
-        m_vad.reset();
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
-
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
-
-    m_in_buf.clear();
+    const auto& vad_buf = segment->samples;
 
     bool vad_status = !vad_buf.empty();
 
@@ -192,7 +253,7 @@ stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
         if ((m_config.speech_mode == speech_mode_t::manual ||
              m_speech_detection_status ==
                  speech_detection_status_t::speech_detected) &&
-            vad_status && !eof)
+            vad_status && !segment->speech_end && !eof)
             return false;
 
         if ((m_config.speech_mode == speech_mode_t::manual ||
@@ -209,16 +270,16 @@ stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
                     m_speech_detection_status ==
                         speech_detection_status_t::no_speech)) {
             flush(eof ? flush_t::eof : flush_t::regular);
-            free_buf();
             return samples_process_result_t::no_samples_needed;
         }
 
-        free_buf();
+        if (vad_status && streaming_decode_due(m_speech_buf.size()))
+            decode_partial_speech();
+
         return samples_process_result_t::wait_for_samples;
     }
 
     if (m_thread_exit_requested) {
-        free_buf();
         return samples_process_result_t::no_samples_needed;
     }
 
@@ -246,8 +307,6 @@ stt_engine::samples_process_result_t fasterwhisper_engine::process_buff() {
               ? flush_t::eof
               : flush_t::regular);
 
-    free_buf();
-
     return samples_process_result_t::wait_for_samples;
 }
 
@@ -258,56 +317,8 @@ void fasterwhisper_engine::decode_speech(const whisper_buf_t& buf) {
 
     auto decoding_start = std::chrono::steady_clock::now();
 
-    auto* pe = py_executor::instance();
-
-    std::string text;
-
-    try {
-        text = pe->execute([&]() {
-                     try {
-                         py::array_t<float> array(buf.size());
-                         auto r = array.mutable_unchecked<1>();
-                         for (py::ssize_t i = 0; i < r.shape(0); ++i)
-                             r(i) = buf[i];
-
-                         auto seg_tuple = m_model->attr("transcribe")(
-                             "audio"_a = array, "beam_size"_a = 5,
-                             "language"_a = m_config.lang,
-                             "task"_a = m_config.translate ? "translate"
-                                                           : "transcribe");
-
-                         auto segments = *seg_tuple.cast<py::list>().begin();
-
-                         std::ostringstream os;
-
-                         auto i = 0;
-                         for (auto& segment : segments) {
-                             auto text =
-                                 segment.attr("text").cast<std::string>();
-
-                             rtrim(text);
-                             ltrim(text);
-
-                             if (text.empty()) continue;
-#ifdef DEBUG
-                             LOGD("segment: " << text);
-#endif
-                             if (i != 0) os << ' ';
-                             os << text;
-
-                             ++i;
-                         }
-
-                         return os.str();
-                     } catch (const std::exception& err) {
-                         LOGE("fasterwhisper py error: " << err.what());
-                         return std::string{""};
-                     }
-                 }).get();
-    } catch (const std::exception& err) {
-        LOGE("fasterwhisper error: " << err.what());
-        return;
-    }
+    auto segments = decode_segments(buf);
+    if (!segments) return;
 
     if (m_thread_exit_requested) return;
 
@@ -321,8 +332,14 @@ void fasterwhisper_engine::decode_speech(const whisper_buf_t& buf) {
                 ((1000 * buf.size()) / static_cast<double>(m_sample_rate))
          << ")");
 
-    auto result = merge_texts(m_intermediate_text.value_or(std::string{}),
-                              std::move(text));
+    std::string text;
+    for (const auto& segment : *segments) text = join_texts(text, segment.text);
+
+    auto result =
+        streaming_enabled()
+            ? m_streaming.finish(std::move(text))
+            : merge_texts(m_intermediate_text.value_or(std::string{}),
+                          std::move(text));
 
 #ifdef DEBUG
     LOGD("speech decoded: text=" << result);
@@ -331,3 +348,96 @@ void fasterwhisper_engine::decode_speech(const whisper_buf_t& buf) {
     if (!m_intermediate_text || m_intermediate_text != result)
         set_intermediate_text(result);
 }
+
+void fasterwhisper_engine::decode_partial_speech() {
+    LOGD("partial speech decoding started: samples=" << m_speech_buf.size());
+
+    set_processing_state(processing_state_t::decoding);
+
+    create_model();
+
+    auto segments = decode_segments(m_speech_buf);
+
+    set_processing_state(processing_state_t::idle);
+
+    if (!segments || m_thread_exit_requested) return;
+
+    m_streaming.decoded_size = m_speech_buf.size();
+
+    // when window gets too long, everything except last segment is committed
+    // to keep amount of work per decode bounded
+    auto trim =
+        std::min(m_streaming.commit(std::move(*segments),
+                                    m_speech_buf.size() > m_streaming_max_window),
+                 m_speech_buf.size());
+
+    if (trim > 0) {
+        LOGD("committed samples trimmed: " << trim);
+        m_speech_buf.erase(m_speech_buf.begin(),
+                           m_speech_buf.begin() + static_cast<long>(trim));
+    }
+
+    auto text = m_streaming.text();
+
+#ifdef DEBUG
+    LOGD("partial speech decoded: text=" << text);
+#endif
+
+    if (!m_intermediate_text || m_intermediate_text != text)
+        set_intermediate_text(text);
+}
+
+std::optional<std::vector<stt_engine::segment_t>>
+fasterwhisper_engine::decode_segments(const whisper_buf_t& buf) {
+    auto* pe = py_executor::instance();
+
+    std::vector<segment_t> segments;
+
+    try {
+        pe->execute([&]() {
+              try {
+                  py::array_t<float> array(buf.size());
+                  auto r = array.mutable_unchecked<1>();
+                  for (py::ssize_t i = 0; i < r.shape(0); ++i) r(i) = buf[i];
+
+                  auto seg_tuple = m_model->attr("transcribe")(
+                      "audio"_a = array, "beam_size"_a = 5,
+                      "language"_a = m_config.lang,
+                      "task"_a =
+                          m_config.translate ? "translate" : "transcribe");
+
+                  auto py_segments = *seg_tuple.cast<py::list>().begin();
+
+                  for (auto& segment : py_segments) {
+                      auto text = segment.attr("text").cast<std::string>();
+
+                      rtrim(text);
+                      ltrim(text);
+
+                      if (text.empty()) continue;
+#ifdef DEBUG
+                      LOGD("segment: " << text);
+#endif
+                      // segment end is in seconds
+                      auto end = std::min(
+                          buf.size(),
+                          static_cast<size_t>(std::max(
+                              0.0, segment.attr("end").cast<double>() *
+                                       m_sample_rate)));
+
+                      segments.push_back({std::move(text), end});
+                  }
+              } catch (const std::exception& err) {
+                  LOGE("fasterwhisper py error: " << err.what());
+                  segments.clear();
+              }
+
+              return std::string{};
+          }).get();
+    } catch (const std::exception& err) {
+        LOGE("fasterwhisper error: " << err.what());
+        return std::nullopt;
+    }
+
+    return segments;
+}
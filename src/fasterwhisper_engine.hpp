@@ -31,14 +31,20 @@ class fasterwhisper_engine : public stt_engine {
 
     inline static const size_t m_speech_max_size = m_sample_rate * 60;  // 60s
     inline static const int m_threads = 8;
+    inline static const size_t m_streaming_max_window =
+        m_sample_rate * 25;  // 25s
 
     std::optional<py::object> m_model;
 
     whisper_buf_t m_speech_buf;
 
     void create_model();
+    bool bench_threads(const py::object& model);
     samples_process_result_t process_buff() override;
     void decode_speech(const whisper_buf_t& buf);
+    void decode_partial_speech();
+    std::optional<std::vector<segment_t>> decode_segments(
+        const whisper_buf_t& buf);
     static void push_buf_to_whisper_buf(
         const std::vector<in_buf_t::buf_t::value_type>& buf,
         whisper_buf_t& whisper_buf);
@@ -8,9 +8,73 @@
 #include "file_source.h"
 
 #include <QDebug>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
-file_source::file_source(const QString &file, QObject *parent)
-    : audio_source{parent}, m_file{file} {
+static uint16_t read_le16(const uchar *data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static uint32_t read_le32(const uchar *data) {
+    return static_cast<uint32_t>(data[0]) |
+           (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) |
+           (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// offset and size of samples if file is pcm wav that doesn't need conversion
+static std::pair<size_t, size_t> pcm_16khz_mono_wav_data(const uchar *data,
+                                                         size_t size) {
+    static const uint16_t format_pcm = 1;
+    static const uint16_t format_extensible = 0xFFFE;
+
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 ||
+        std::memcmp(data + 8, "WAVE", 4) != 0)
+        return {0, 0};
+
+    bool fmt_ok = false;
+
+    for (size_t pos = 12; pos + 8 <= size;) {
+        const auto *id = data + pos;
+        size_t chunk_size = read_le32(data + pos + 4);
+        const auto *chunk = data + pos + 8;
+        pos += 8;
+
+        if (std::memcmp(id, "fmt ", 4) == 0) {
+            if (chunk_size < 16 || pos + chunk_size > size) return {0, 0};
+
+            auto format = read_le16(chunk);
+            // sub-format guid starts with format code
+            if (format == format_extensible && chunk_size >= 26)
+                format = read_le16(chunk + 24);
+
+            fmt_ok = format == format_pcm && read_le16(chunk + 2) == 1 &&
+                     read_le32(chunk + 4) == 16000 &&
+                     read_le16(chunk + 14) == 16;
+            if (!fmt_ok) return {0, 0};
+        } else if (std::memcmp(id, "data", 4) == 0) {
+            if (!fmt_ok) return {0, 0};
+
+            // size in header may be invalid when file was not finalized
+            chunk_size = std::min(chunk_size, size - pos) & ~size_t{1};
+
+            return {pos, chunk_size};
+        }
+
+        // chunks are word aligned
+        pos += chunk_size + (chunk_size & 1);
+    }
+
+    return {0, 0};
+}
+
+file_source::file_source(const QString &file,
+                         media_compressor::resampler_t resampler,
+                         uint64_t start_time_ms, QObject *parent)
+    : audio_source{parent}, m_file{file}, m_start_time_ms{start_time_ms} {
+    m_mc.set_resampler(resampler);
     start();
 }
 
@@ -21,72 +85,124 @@ void file_source::stop() {
     m_mc.cancel();
 }
 
-void file_source::slowdown() {
-    if (m_timer.interval() == m_timer_slow) return;
+void file_source::start() {
+    if (start_wav()) {
+        // source is connected after construction
+        QTimer::singleShot(0, this, &file_source::audio_available);
+        return;
+    }
 
-    // qDebug() << "slowdown";
-    m_timer.setInterval(m_timer_slow);
-    m_timer.start();
+    // callbacks are called from decoder thread
+    m_mc.decompress_to_sink_async(
+        {m_file.toStdString()},
+        /*data_ready_callback=*/[this] { handle_data_ready(); },
+        /*task_finished_callback=*/[this] { handle_decoding_finished(); },
+        {m_start_time_ms, media_compressor::clip_info_t::max, 0,
+         media_compressor::clip_info_t::max});
 }
 
-void file_source::speedup() {
-    if (m_timer.interval() == m_timer_quick) return;
+bool file_source::attach_sink(audio_sink *sink) {
+    // mapped wav is copied in read_audio
+    if (m_wav_data) return false;
 
-    // qDebug() << "speedup";
-    m_timer.setInterval(m_timer_quick);
-    m_timer.start();
+    m_data_pending = false;
+    m_mc.set_sink(sink);
+
+    return true;
 }
 
-void file_source::start() {
-    connect(&m_timer, &QTimer::timeout, this,
-            &file_source::handle_read_timeout);
-    m_timer.setInterval(m_timer_quick);
-    m_timer.start();
-
-    m_mc.decompress_to_raw_async({m_file.toStdString()}, /*mono_16khz=*/true,
-                                 /*data_ready_callback=*/{},
-                                 /*task_finished_callback=*/{});
+bool file_source::start_wav() {
+    if (!m_file.endsWith(QLatin1String{".wav"}, Qt::CaseInsensitive))
+        return false;
+
+    m_wav_file.setFileName(m_file);
+    if (!m_wav_file.open(QIODevice::ReadOnly)) return false;
+
+    const auto *data = m_wav_file.map(0, m_wav_file.size());
+    if (!data) {
+        m_wav_file.close();
+        return false;
+    }
+
+    auto [offset, size] =
+        pcm_16khz_mono_wav_data(data, static_cast<size_t>(m_wav_file.size()));
+    if (offset == 0) {
+        m_wav_file.close();
+        return false;
+    }
+
+    qDebug() << "reading pcm wav directly:" << m_file;
+
+    m_wav_data = reinterpret_cast<const char *>(data + offset);
+    m_wav_size = size;
+    // 16kHz s16 is 32 bytes per ms
+    m_wav_pos = std::min<uint64_t>(m_start_time_ms * 32, m_wav_size);
+
+    return true;
 }
 
-void file_source::handle_read_timeout() {
+void file_source::handle_data_ready() {
+    // decoder calls back repeatedly while it waits for sink, consumer needs
+    // only one notification until it attaches
+    if (!m_data_pending.exchange(true)) emit audio_available();
+}
+
+void file_source::handle_decoding_finished() {
     if (m_mc.error()) {
         qWarning() << "audio decoder error";
-        m_timer.stop();
         emit error();
         return;
     }
 
-    if (!m_eof) {
-        emit audio_available();
-    } else if (m_eof && !m_ended) {
-        emit audio_available();
-
-        m_ended = true;
-        emit ended();
-        m_timer.stop();
-    }
+    // eof was written to sink
+    m_ended = true;
+    emit ended();
+    emit audio_available();
 }
 
 void file_source::clear() {
     // do nothing
 }
 
-double file_source::progress() const { return m_progress; }
+double file_source::progress() const {
+    if (m_wav_data) return m_progress;
+    if (m_ended) return 1.0;
+
+    auto info = m_mc.data_info();
+    if (info.total == 0) return 0.0;
+
+    return std::min(1.0, info.bytes_read / static_cast<double>(info.total));
+}
 
-file_source::audio_data file_source::read_audio(char *buf, size_t max_size) {
+file_source::audio_data file_source::read_wav_audio(char *buf,
+                                                    size_t max_size) {
     audio_data data;
     data.data = buf;
-    data.sof = m_sof;
+    data.sof = std::exchange(m_sof, false);
+    data.size = std::min(max_size, m_wav_size - m_wav_pos) & ~size_t{1};
 
-    auto info = m_mc.get_data(data.data, max_size);
+    std::memcpy(buf, m_wav_data + m_wav_pos, data.size);
+    m_wav_pos += data.size;
 
-    data.size = info.size;
-    data.eof = info.eof;
-
-    m_eof = data.eof;
-    m_sof = false;
+    data.eof = m_wav_pos == m_wav_size;
     m_progress =
-        std::min(1.0, info.bytes_read / static_cast<double>(info.total));
+        m_wav_size == 0 ? 1.0 : m_wav_pos / static_cast<double>(m_wav_size);
+
+    if (data.eof && !m_ended) {
+        m_ended = true;
+        emit ended();
+    }
+
+    return data;
+}
+
+file_source::audio_data file_source::read_audio(
+    char *buf, [[maybe_unused]] size_t max_size) {
+    if (m_wav_data) return read_wav_audio(buf, max_size);
+
+    // decoded audio is written directly to attached sink
+    audio_data data;
+    data.data = buf;
 
     return data;
 }
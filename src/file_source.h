@@ -8,10 +8,10 @@
 #ifndef FILE_SOURCE_H
 #define FILE_SOURCE_H
 
-#include <QByteArray>
+#include <QFile>
 #include <QObject>
 #include <QString>
-#include <QTimer>
+#include <atomic>
 
 #include "audio_source.h"
 #include "media_compressor.hpp"
@@ -19,33 +19,42 @@
 class file_source : public audio_source {
     Q_OBJECT
    public:
-    explicit file_source(const QString &file, QObject *parent = nullptr);
+    explicit file_source(const QString &file,
+                         media_compressor::resampler_t resampler =
+                             media_compressor::resampler_t::swr_medium,
+                         uint64_t start_time_ms = 0,
+                         QObject *parent = nullptr);
     bool ok() const override;
     audio_data read_audio(char *buf, size_t max_size) override;
     double progress() const override;
     void clear() override;
     void stop() override;
-    void slowdown() override;
-    void speedup() override;
+    bool attach_sink(audio_sink *sink) override;
     inline source_type type() const override { return source_type::file; }
     inline QString audio_file() const { return m_file; }
 
    private:
-    static const int m_timer_quick = 5;
-    static const int m_timer_slow = 100;
-
-    QTimer m_timer;
-    QByteArray m_buf;
     QString m_file;
-    bool m_eof = false;
+    // audio before this position is skipped
+    uint64_t m_start_time_ms = 0;
     bool m_sof = true;
-    bool m_ended = false;
+    std::atomic_bool m_ended = false;
     bool m_error = false;
-    media_compressor m_mc;
+    // audio_available was emitted and sink has not been attached yet
+    std::atomic_bool m_data_pending = false;
     double m_progress = 0.0;
+    media_compressor m_mc;
+    // 16kHz mono s16 wav is read directly from mapped file
+    QFile m_wav_file;
+    const char *m_wav_data = nullptr;
+    size_t m_wav_size = 0;
+    size_t m_wav_pos = 0;
 
     void start();
-    void handle_read_timeout();
+    bool start_wav();
+    audio_data read_wav_audio(char *buf, size_t max_size);
+    void handle_data_ready();
+    void handle_decoding_finished();
 };
 
 #endif  // FILE_SOURCE_H
@@ -13,6 +13,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
@@ -180,6 +181,29 @@ std::ostream& operator<<(std::ostream& os,
     return os;
 }
 
+std::ostream& operator<<(std::ostream& os,
+                         media_compressor::resampler_t resampler) {
+    switch (resampler) {
+        case media_compressor::resampler_t::swr_fast:
+            os << "swr-fast";
+            break;
+        case media_compressor::resampler_t::swr_medium:
+            os << "swr-medium";
+            break;
+        case media_compressor::resampler_t::swr_high:
+            os << "swr-high";
+            break;
+        case media_compressor::resampler_t::filter_graph:
+            os << "filter-graph";
+            break;
+    }
+
+    return os;
+}
+
+media_compressor::media_compressor(size_t out_buf_size)
+    : m_out_buf_size{out_buf_size} {}
+
 media_compressor::~media_compressor() {
     cancel();
     clean_av();
@@ -205,7 +229,10 @@ media_compressor::format_t media_compressor::format_from_filename(
 }
 
 void media_compressor::cancel() {
-    m_shutdown = true;
+    {
+        std::lock_guard lock{m_mtx};
+        m_shutdown = true;
+    }
 
     m_cv.notify_all();
 
@@ -222,6 +249,7 @@ void media_compressor::clean_av() {
         avfilter_inout_free(&m_av_filter_ctx.out);
     if (m_av_filter_ctx.graph != nullptr)
         avfilter_graph_free(&m_av_filter_ctx.graph);
+    if (m_swr_ctx != nullptr) swr_free(&m_swr_ctx);
 
     if (m_av_fifo) {
         av_audio_fifo_free(m_av_fifo);
@@ -341,6 +369,44 @@ void media_compressor::init_av_filter(const char* arg) {
     }
 }
 
+void media_compressor::init_swr() {
+    if (m_in_av_audio_ctx->ch_layout.order == AV_CHANNEL_ORDER_UNSPEC)
+        av_channel_layout_default(&m_in_av_audio_ctx->ch_layout,
+                                  m_in_av_audio_ctx->ch_layout.nb_channels);
+
+    if (swr_alloc_set_opts2(
+            &m_swr_ctx, &m_out_av_audio_ctx->ch_layout,
+            m_out_av_audio_ctx->sample_fmt, m_out_av_audio_ctx->sample_rate,
+            &m_in_av_audio_ctx->ch_layout, m_in_av_audio_ctx->sample_fmt,
+            m_in_av_audio_ctx->sample_rate, 0, nullptr) < 0) {
+        clean_av();
+        throw std::runtime_error("swr_alloc_set_opts2 error");
+    }
+
+    // swr defaults are filter_size=32, phase_shift=10
+    switch (m_resampler) {
+        case resampler_t::swr_fast:
+            av_opt_set_int(m_swr_ctx, "filter_size", 8, 0);
+            av_opt_set_int(m_swr_ctx, "phase_shift", 6, 0);
+            av_opt_set_int(m_swr_ctx, "linear_interp", 1, 0);
+            break;
+        case resampler_t::swr_high:
+            av_opt_set_int(m_swr_ctx, "filter_size", 64, 0);
+            av_opt_set_int(m_swr_ctx, "phase_shift", 12, 0);
+            break;
+        case resampler_t::swr_medium:
+        case resampler_t::filter_graph:
+            break;
+    }
+
+    if (swr_init(m_swr_ctx) < 0) {
+        clean_av();
+        throw std::runtime_error("swr_init error");
+    }
+
+    m_swr_samples = 0;
+}
+
 void media_compressor::init_av_in_format(const std::string& input_file) {
     clean_av_in_format();
 
@@ -369,6 +435,20 @@ void media_compressor::init_av_in_format(const std::string& input_file) {
         throw std::runtime_error("no audio stream found in input file");
     }
 
+    // demuxer skips packets of discarded streams (e.g. video in mkv, mp4)
+    // without reading their payload
+    for (unsigned int i = 0; i < m_in_av_format_ctx->nb_streams; ++i) {
+        if (static_cast<int>(i) == m_in_audio_stream_idx) continue;
+
+        auto* stream = m_in_av_format_ctx->streams[i];
+        stream->discard = AVDISCARD_ALL;
+
+        const auto* type =
+            av_get_media_type_string(stream->codecpar->codec_type);
+        LOGD("discarding stream: idx=" << i
+                                       << ", type=" << (type ? type : "?"));
+    }
+
     //    const auto* in_stream =
     //    m_in_av_format_ctx->streams[m_in_audio_stream_idx];
 
@@ -616,7 +696,12 @@ void media_compressor::init_av(task_t task) {
             throw std::runtime_error("av_audio_fifo_alloc error");
         }
 
-        init_av_filter("anull");
+        LOGD("resampler: " << m_resampler);
+
+        if (m_resampler == resampler_t::filter_graph)
+            init_av_filter("anull");
+        else
+            init_swr();
     }
 
     auto* format_name = [&]() {
@@ -713,27 +798,26 @@ void media_compressor::init_av(task_t task) {
 }
 
 void media_compressor::write_to_buf(const char* data, int size) {
-    if (size > BUF_MAX_SIZE)
-        throw std::runtime_error("data size too large: " +
-                                 std::to_string(size));
+    if (!m_out_buf) throw std::runtime_error("no out buf");
 
-    std::unique_lock lock{m_mtx};
-    m_cv.wait(lock, [&]() {
-        if (m_shutdown) return true;
-        if (m_buf.size() + size <= BUF_MAX_SIZE) return true;
+    auto remaining = static_cast<size_t>(size);
 
-        if (m_data_ready_callback) m_data_ready_callback();
+    while (true) {
+        auto written = m_out_buf->write(data, remaining);
+        data += written;
+        remaining -= written;
 
-        return false;
-    });
+        if (written > 0 && m_data_ready_callback) m_data_ready_callback();
 
-    if (!m_shutdown) {
-        auto old_size = m_buf.size();
-        m_buf.resize(m_buf.size() + size);
-        memcpy(std::next(m_buf.data(), old_size), data, size);
-    }
+        if (remaining == 0) break;
+
+        std::unique_lock lock{m_mtx};
+        m_cv.wait(lock, [&]() {
+            return m_shutdown || m_out_buf->free_size() > 0;
+        });
 
-    lock.unlock();
+        if (m_shutdown) break;
+    }
 }
 
 int media_compressor::write_packet_callback(void* opaque, uint8_t* buf,
@@ -791,8 +875,18 @@ void media_compressor::decompress_async_internal(
 
     init_av(task);
 
+    if (m_sink_mode) seek_to_clip_start();
+
     if (m_async_thread.joinable()) m_async_thread.join();
     m_data_ready_callback = std::move(data_ready_callback);
+    if (m_sink_mode)
+        m_out_buf.reset();
+    else
+        m_out_buf.emplace(m_out_buf_size);
+    m_out_eof = false;
+    m_sink_sof = true;
+    m_sink_notified = false;
+    m_sink_skip_samples.reset();
 
     m_async_thread =
         std::thread([this, callback = std::move(task_finished_callback)]() {
@@ -807,7 +901,12 @@ void media_compressor::decompress_async_internal(
                 m_error = true;
             }
 
-            if (m_data_ready_callback && m_buf.size() > 0)
+            // decoder may still flush data after demuxer eof, so eof is
+            // reported to consumer only when all output is written
+            if (m_sink_mode && !m_error) write_sink_eof();
+            m_out_eof = true;
+
+            if (m_data_ready_callback && data_size() > 0)
                 m_data_ready_callback();
             if (callback) callback();
         });
@@ -819,17 +918,50 @@ void media_compressor::decompress_to_raw_async(
     task_finished_callback_t task_finished_callback) {
     LOGD("task decompress to raw async");
 
+    m_sink_mode = false;
+
     decompress_async_internal(
         task_t::decompress_raw_async, std::move(input_files), mono_16khz,
         std::move(data_ready_callback), std::move(task_finished_callback));
 }
 
+void media_compressor::decompress_to_sink_async(
+    std::vector<std::string> input_files,
+    data_ready_callback_t data_ready_callback,
+    task_finished_callback_t task_finished_callback, clip_info_t clip_info) {
+    LOGD("task decompress to sink async");
+
+    m_sink_mode = true;
+    m_clip_info = clip_info;
+
+    // only swr can write into sink memory
+    if (m_resampler == resampler_t::filter_graph)
+        m_resampler = resampler_t::swr_medium;
+
+    decompress_async_internal(
+        task_t::decompress_raw_async, std::move(input_files),
+        /*mono_16khz=*/true, std::move(data_ready_callback),
+        std::move(task_finished_callback));
+}
+
+void media_compressor::set_sink(audio_sink* sink) {
+    {
+        std::lock_guard lock{m_mtx};
+        m_sink = sink;
+        m_sink_notified = true;
+    }
+
+    m_cv.notify_all();
+}
+
 void media_compressor::decompress_to_wav_async(
     std::vector<std::string> input_files, bool mono_16khz,
     data_ready_callback_t data_ready_callback,
     task_finished_callback_t task_finished_callback) {
     LOGD("task decompress to wav async");
 
+    m_sink_mode = false;
+
     decompress_async_internal(
         task_t::decompress_wav_async, std::move(input_files), mono_16khz,
         std::move(data_ready_callback), std::move(task_finished_callback));
@@ -1044,6 +1176,7 @@ bool media_compressor::read_frame(AVPacket* pkt) {
 
         if (pkt->flags & AV_PKT_FLAG_CORRUPT) LOGD("corrupt pkt");
 
+        // not all demuxers honor discard flag
         if (pkt->stream_index != m_in_audio_stream_idx) {
             av_packet_unref(pkt);
             continue;
@@ -1218,6 +1351,8 @@ bool media_compressor::decode_frame(AVPacket* pkt, AVFrame* frame_in,
 }
 
 bool media_compressor::filter_frame(AVFrame* frame_in, AVFrame* frame_out) {
+    if (m_swr_ctx) return resample_frame(frame_in, frame_out);
+
     if (av_buffersrc_add_frame_flags(m_av_filter_ctx.src_ctx, frame_in,
                                      AV_BUFFERSRC_FLAG_PUSH) < 0) {
         av_frame_unref(frame_in);
@@ -1236,6 +1371,176 @@ bool media_compressor::filter_frame(AVFrame* frame_in, AVFrame* frame_out) {
     return true;
 }
 
+bool media_compressor::resample_frame(AVFrame* frame_in, AVFrame* frame_out) {
+    if (m_sink_mode) {
+        resample_frame_to_sink(frame_in);
+        return false;
+    }
+
+    // null frame_in flushes samples buffered in resampler
+    auto in_samples = frame_in ? frame_in->nb_samples : 0;
+
+    auto out_samples = swr_get_out_samples(m_swr_ctx, in_samples);
+    if (out_samples <= 0) {
+        if (frame_in) av_frame_unref(frame_in);
+        return false;
+    }
+
+    frame_out->nb_samples = out_samples;
+    av_channel_layout_copy(&frame_out->ch_layout,
+                           &m_out_av_audio_ctx->ch_layout);
+    frame_out->format = m_out_av_audio_ctx->sample_fmt;
+    frame_out->sample_rate = m_out_av_audio_ctx->sample_rate;
+
+    if (av_frame_get_buffer(frame_out, 0) != 0) {
+        if (frame_in) av_frame_unref(frame_in);
+        throw std::runtime_error("av_frame_get_buffer error");
+    }
+
+    auto ret = swr_convert(
+        m_swr_ctx, frame_out->data, out_samples,
+        frame_in ? const_cast<const uint8_t**>(frame_in->extended_data)
+                 : nullptr,
+        in_samples);
+
+    if (frame_in) av_frame_unref(frame_in);
+
+    if (ret <= 0) {
+        av_frame_unref(frame_out);
+        if (ret < 0) throw std::runtime_error("swr_convert error");
+        return false;
+    }
+
+    frame_out->nb_samples = ret;
+    frame_out->pts =
+        av_rescale_q(m_swr_samples, AVRational{1, frame_out->sample_rate},
+                     m_out_av_audio_ctx->time_base);
+    m_swr_samples += ret;
+
+    return true;
+}
+
+std::pair<char*, size_t> media_compressor::borrow_sink_buf(
+    std::unique_lock<std::mutex>& lock) {
+    while (!m_shutdown) {
+        if (m_sink) {
+            auto buf = m_sink->borrow_buf();
+            if (buf.first && buf.second >= sizeof(int16_t)) return buf;
+        } else if (m_data_ready_callback) {
+            // consumer should attach sink
+            m_data_ready_callback();
+        }
+
+        // consumer attaches sink again when it has free space
+        m_cv.wait(lock, [this] {
+            return m_shutdown || std::exchange(m_sink_notified, false);
+        });
+    }
+
+    return {nullptr, 0};
+}
+
+void media_compressor::seek_to_clip_start() {
+    // pcm input is clipped by bytes in read_frame
+    if (m_clip_info.start_time_ms == 0 || m_clip_info.start_bytes > 0) return;
+
+    const auto* in_stream = m_in_av_format_ctx->streams[m_in_audio_stream_idx];
+
+    auto ts = av_rescale_q(static_cast<int64_t>(m_clip_info.start_time_ms),
+                           AVRational{1, 1000}, in_stream->time_base);
+    if (in_stream->start_time != AV_NOPTS_VALUE) ts += in_stream->start_time;
+
+    // demuxer lands on packet before ts, samples up to ts are dropped later
+    if (auto ret = av_seek_frame(m_in_av_format_ctx, m_in_audio_stream_idx, ts,
+                                 AVSEEK_FLAG_BACKWARD);
+        ret < 0) {
+        LOGW("av_seek_frame error: " << ret << " " << str_from_av_error(ret));
+    } else {
+        LOGD("seek to clip start: " << m_clip_info.start_time_ms << "ms");
+    }
+}
+
+uint64_t media_compressor::sink_samples_to_skip(const AVFrame* frame) const {
+    if (m_clip_info.start_time_ms == 0 || frame->pts == AV_NOPTS_VALUE)
+        return 0;
+
+    const auto* in_stream = m_in_av_format_ctx->streams[m_in_audio_stream_idx];
+
+    auto pts = frame->pts;
+    if (in_stream->start_time != AV_NOPTS_VALUE) pts -= in_stream->start_time;
+
+    auto frame_ms =
+        av_rescale_q(pts, in_stream->time_base, AVRational{1, 1000});
+    if (frame_ms < 0) frame_ms = 0;
+
+    if (static_cast<uint64_t>(frame_ms) >= m_clip_info.start_time_ms) return 0;
+
+    // output is 16kHz
+    return (m_clip_info.start_time_ms - frame_ms) * 16;
+}
+
+void media_compressor::resample_frame_to_sink(AVFrame* frame_in) {
+    // null frame_in flushes samples buffered in resampler
+    const auto** in =
+        frame_in ? const_cast<const uint8_t**>(frame_in->extended_data)
+                 : nullptr;
+    auto in_samples = frame_in ? frame_in->nb_samples : 0;
+
+    if (!m_sink_skip_samples && frame_in)
+        m_sink_skip_samples = sink_samples_to_skip(frame_in);
+
+    std::unique_lock lock{m_mtx};
+
+    while (true) {
+        auto [buf, size] = borrow_sink_buf(lock);
+        if (!buf) break;
+
+        auto out_samples = static_cast<int>(size / sizeof(int16_t));
+        auto* out = reinterpret_cast<uint8_t*>(buf);
+
+        // input that doesn't fit into buf is buffered in resampler and
+        // drained in next iterations
+        auto ret = swr_convert(m_swr_ctx, &out, out_samples, in, in_samples);
+        in_samples = 0;
+
+        if (ret < 0) {
+            if (frame_in) av_frame_unref(frame_in);
+            throw std::runtime_error("swr_convert error");
+        }
+
+        if (ret > 0 && m_sink_skip_samples && *m_sink_skip_samples > 0) {
+            // samples before clip start are overwritten by next ones
+            auto skip = static_cast<int>(
+                std::min<uint64_t>(*m_sink_skip_samples, ret));
+            std::memmove(buf, buf + skip * sizeof(int16_t),
+                         (ret - skip) * sizeof(int16_t));
+            *m_sink_skip_samples -= skip;
+            ret -= skip;
+            if (ret == 0) continue;
+        }
+
+        if (ret > 0) {
+            m_sink->return_buf(buf, ret * sizeof(int16_t),
+                               std::exchange(m_sink_sof, false),
+                               /*eof=*/false);
+        }
+
+        if (ret < out_samples) break;
+    }
+
+    if (frame_in) av_frame_unref(frame_in);
+}
+
+void media_compressor::write_sink_eof() {
+    std::unique_lock lock{m_mtx};
+
+    auto [buf, size] = borrow_sink_buf(lock);
+    if (!buf) return;
+
+    m_sink->return_buf(buf, 0, std::exchange(m_sink_sof, false),
+                       /*eof=*/true);
+}
+
 bool media_compressor::encode_frame(AVFrame* frame, AVPacket* pkt) {
     if (auto ret = avcodec_send_frame(m_out_av_audio_ctx, frame);
         ret != 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
@@ -1260,29 +1565,49 @@ bool media_compressor::encode_frame(AVFrame* frame, AVPacket* pkt) {
     return true;
 }
 
-size_t media_compressor::data_size() const { return m_buf.size(); }
+size_t media_compressor::data_size() const {
+    return m_out_buf ? m_out_buf->size() : 0;
+}
+
+media_compressor::data_info_t media_compressor::out_data_info(size_t size,
+                                                              bool eof) const {
+    auto info = m_data_info;
+
+    info.size = size;
+    info.eof = eof;
+
+    if (m_in_av_format_ctx && m_in_av_format_ctx->pb) {
+        // position instead of bytes read because packets of discarded
+        // streams are skipped by seeking
+        info.bytes_read = std::max<int64_t>(0, m_in_av_format_ctx->pb->pos);
+    } else {
+        info.bytes_read = info.total;
+    }
+
+    return info;
+}
+
+media_compressor::data_info_t media_compressor::data_info() const {
+    return out_data_info(data_size(), m_out_eof);
+}
+
+media_compressor::pcm_format_t media_compressor::raw_format() const {
+    if (!m_out_av_audio_ctx) return {};
+
+    return {m_out_av_audio_ctx->sample_rate,
+            m_out_av_audio_ctx->ch_layout.nb_channels};
+}
 
 media_compressor::data_info_t media_compressor::get_data(char* data,
                                                          size_t max_size) {
-    std::unique_lock lock{m_mtx};
+    if (!m_out_buf) return out_data_info(0, false);
 
-    m_data_info.size = std::min(max_size, m_buf.size());
+    bool eof = m_out_eof;
 
-    if (m_data_info.size > 0) {
-        memcpy(data, m_buf.data(), m_data_info.size);
-        memmove(m_buf.data(), m_buf.data() + m_data_info.size,
-                m_buf.size() - m_data_info.size);
-        m_buf.resize(m_buf.size() - m_data_info.size);
-    }
+    auto size = m_out_buf->read(data, max_size);
 
-    lock.unlock();
+    { std::lock_guard lock{m_mtx}; }
     m_cv.notify_all();
 
-    if (m_in_av_format_ctx && m_in_av_format_ctx->pb) {
-        m_data_info.bytes_read = m_in_av_format_ctx->pb->bytes_read;
-    } else {
-        m_data_info.bytes_read = m_data_info.total;
-    }
-
-    return m_data_info;
+    return out_data_info(size, eof && m_out_buf->empty());
 }
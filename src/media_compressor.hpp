@@ -8,12 +8,16 @@
 #ifndef MEDIA_COMPRESSOR_HPP
 #define MEDIA_COMPRESSOR_HPP
 
+#include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <mutex>
+#include <optional>
 #include <queue>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 extern "C" {
@@ -26,8 +30,12 @@ extern "C" {
 #include <libavutil/audio_fifo.h>
 #include <libavutil/dict.h>
 #include <libavutil/opt.h>
+#include <libswresample/swresample.h>
 }
 
+#include "audio_sink.hpp"
+#include "ring_buffer.hpp"
+
 class media_compressor {
    public:
     enum class format_t { unknown, wav, mp3, ogg_vorbis, ogg_opus, flac };
@@ -36,10 +44,16 @@ class media_compressor {
     enum class quality_t { vbr_high, vbr_medium, vbr_low };
     friend std::ostream& operator<<(std::ostream& os, quality_t quality);
 
+    // conversion of decoded audio to output sample format, rate and layout
+    enum class resampler_t { swr_fast, swr_medium, swr_high, filter_graph };
+    friend std::ostream& operator<<(std::ostream& os, resampler_t resampler);
+
     using task_finished_callback_t = std::function<void()>;
     using data_ready_callback_t = std::function<void()>;
 
     static const int BUF_MAX_SIZE = 16384;
+    // 8s of mono 16kHz s16 audio
+    static const size_t OUT_BUF_DEFAULT_SIZE = 262144;
 
     struct data_info_t {
         size_t size = 0;
@@ -48,6 +62,12 @@ class media_compressor {
         bool eof = false;
     };
 
+    // format of s16 samples of raw output
+    struct pcm_format_t {
+        int sample_rate = 0;
+        int channels = 0;
+    };
+
     struct clip_info_t {
         static const uint64_t max = std::numeric_limits<uint64_t>::max();
 
@@ -60,7 +80,7 @@ class media_compressor {
         inline bool valid_bytes() const { return start_bytes < stop_bytes; }
     };
 
-    media_compressor() = default;
+    explicit media_compressor(size_t out_buf_size = OUT_BUF_DEFAULT_SIZE);
     ~media_compressor();
     bool is_media_file(const std::string& input_file);
     void compress(std::vector<std::string> input_files, std::string output_file,
@@ -80,10 +100,30 @@ class media_compressor {
         std::vector<std::string> input_files, bool mono_16khz,
         data_ready_callback_t data_ready_callback,
         task_finished_callback_t task_finished_callback);
+    // mono 16kHz s16 samples are resampled straight into memory of sink
+    // attached with set_sink, data_ready_callback is called when decoder
+    // waits for sink to be attached or to have free space, decoding starts
+    // from clip_info.start_time_ms
+    void decompress_to_sink_async(
+        std::vector<std::string> input_files,
+        data_ready_callback_t data_ready_callback,
+        task_finished_callback_t task_finished_callback,
+        clip_info_t clip_info = {0, 0, 0, 0});
+    // blocks until decoder stops using previous sink, nullptr detaches,
+    // attaching the same sink again wakes decoder waiting for free space
+    void set_sink(audio_sink* sink);
+    // progress of reading input
+    data_info_t data_info() const;
+    // valid when task has been started
+    pcm_format_t raw_format() const;
     data_info_t get_data(char* data, size_t max_size);
     size_t data_size() const;
     void cancel();
     inline bool error() const { return m_error; }
+    // must be set before task is started
+    inline void set_resampler(resampler_t resampler) {
+        m_resampler = resampler;
+    }
 
    private:
     enum class task_t {
@@ -110,6 +150,9 @@ class media_compressor {
     AVCodecContext* m_in_av_audio_ctx = nullptr;
     AVCodecContext* m_out_av_audio_ctx = nullptr;
     filter_ctx m_av_filter_ctx;
+    resampler_t m_resampler = resampler_t::swr_medium;
+    SwrContext* m_swr_ctx = nullptr;
+    int64_t m_swr_samples = 0;  // samples output so far
     AVAudioFifo* m_av_fifo = nullptr;
     int m_in_audio_stream_idx = 0;
     bool m_shutdown = false;
@@ -117,7 +160,17 @@ class media_compressor {
     std::condition_variable m_cv;
     std::mutex m_mtx;
     bool m_error = false;
-    std::vector<char> m_buf;
+    // decoded output of async tasks, created when task starts
+    size_t m_out_buf_size = OUT_BUF_DEFAULT_SIZE;
+    std::optional<ring_buffer<char>> m_out_buf;
+    std::atomic_bool m_out_eof = false;
+    // output of sink task, guarded by m_mtx
+    bool m_sink_mode = false;
+    audio_sink* m_sink = nullptr;
+    bool m_sink_notified = false;
+    bool m_sink_sof = true;
+    // output samples before clip start that are dropped after seek
+    std::optional<uint64_t> m_sink_skip_samples;
     data_info_t m_data_info;
     clip_info_t m_clip_info;
     bool m_mono_16khz = false;
@@ -127,6 +180,7 @@ class media_compressor {
 
     void init_av(task_t task);
     void init_av_filter(const char* arg);
+    void init_swr();
     void init_av_in_format(const std::string& input_file);
     void clean_av();
     void clean_av_in_format();
@@ -135,6 +189,12 @@ class media_compressor {
     bool decode_frame(AVPacket* pkt, AVFrame* frame_in, AVFrame* frame_out);
     bool encode_frame(AVFrame* frame, AVPacket* pkt);
     bool filter_frame(AVFrame* frame_in, AVFrame* frame_out);
+    bool resample_frame(AVFrame* frame_in, AVFrame* frame_out);
+    void resample_frame_to_sink(AVFrame* frame_in);
+    std::pair<char*, size_t> borrow_sink_buf(std::unique_lock<std::mutex>& lock);
+    void write_sink_eof();
+    void seek_to_clip_start();
+    uint64_t sink_samples_to_skip(const AVFrame* frame) const;
     static format_t format_from_filename(const std::string& filename);
     void compress_internal(std::vector<std::string> input_files,
                            std::string output_file, format_t format,
@@ -146,6 +206,7 @@ class media_compressor {
         data_ready_callback_t&& data_ready_callback,
         task_finished_callback_t&& task_finished_callback);
     void write_to_buf(const char* data, int size);
+    data_info_t out_data_info(size_t size, bool eof) const;
     static int write_packet_callback(void* opaque, uint8_t* buf, int buf_size);
 };
 
@@ -125,7 +125,7 @@ void mimic3_engine::create_model() {
 bool mimic3_engine::model_created() const { return static_cast<bool>(m_tts); }
 
 bool mimic3_engine::encode_speech_impl(const std::string& text,
-                                      const std::string& out_file) {
+                                       pcm_sink& sink) {
     auto* pe = py_executor::instance();
 
     auto length_scale =
@@ -133,17 +133,6 @@ bool mimic3_engine::encode_speech_impl(const std::string& text,
 
     LOGD("length_scale: " << length_scale);
 
-    std::ofstream wav_file{out_file, std::ios::binary};
-
-    if (wav_file.bad()) {
-        LOGE("failed to open file for writting: " << out_file);
-        return false;
-    }
-
-    wav_file.seekp(sizeof(wav_header));
-
-    int sample_rate = 0;
-
     bool ok = false;
 
     try {
@@ -157,19 +146,15 @@ bool mimic3_engine::encode_speech_impl(const std::string& text,
                        auto results = m_tts->attr("end_utterance")();
 
                        for (auto& result : results) {
-                           sample_rate =
-                               result.attr("sample_rate_hz").cast<int>();
-
-                           auto bytes = result.attr("audio_bytes");
-
-                           std::vector<unsigned char> data;
-                           data.reserve(py::len(bytes));
+                           sink.set_format(
+                               result.attr("sample_rate_hz").cast<int>(), 1);
 
-                           for (const auto& byte : bytes)
-                               data.push_back(byte.cast<unsigned char>());
+                           auto data = result.attr("audio_bytes")
+                                           .cast<std::string>();
 
-                           wav_file.write(reinterpret_cast<char*>(data.data()),
-                                          data.size());
+                           sink.write(
+                               reinterpret_cast<const int16_t*>(data.data()),
+                               data.size() / sizeof(int16_t));
                        }
                    } catch (const std::exception& err) {
                        LOGE("py error: " << err.what());
@@ -182,27 +167,7 @@ bool mimic3_engine::encode_speech_impl(const std::string& text,
         LOGE("error: " << err.what());
     }
 
-    if (!ok) {
-        wav_file.close();
-        unlink(out_file.c_str());
-        return false;
-    }
-
-    auto data_size = wav_file.tellp();
-
-    if (data_size == sizeof(wav_header)) {
-        LOGE("no audio data");
-        wav_file.close();
-        unlink(out_file.c_str());
-        return false;
-    }
-
-    wav_file.seekp(0);
-
-    LOGD("sample rate: " << sample_rate);
-
-    write_wav_header(sample_rate, sizeof(short), 1, data_size / sizeof(short),
-                     wav_file);
+    if (!ok) return false;
 
     LOGD("voice synthesized successfully");
 
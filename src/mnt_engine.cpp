@@ -19,6 +19,7 @@
 #include "cpu_tools.hpp"
 #include "logger.hpp"
 #include "text_tools.hpp"
+#include "thread_tuner.hpp"
 
 std::ostream& operator<<(std::ostream& os,
                          const mnt_engine::model_files_t& model_files) {
@@ -289,6 +290,19 @@ void mnt_engine::process() {
     LOGD("mnt processing done");
 }
 
+const std::string& mnt_engine::bench_text() {
+    // sentences differ so that translation cache is not used
+    static const auto text = [] {
+        std::string text;
+        for (int i = 1; i <= 16; ++i)
+            text.append("This is sentence number " + std::to_string(i) +
+                        ", which is used to measure the speed of translation. ");
+        return text;
+    }();
+
+    return text;
+}
+
 bool mnt_engine::model_created() const {
     return static_cast<bool>(m_bergamot_ctx_first) &&
            (m_config.model_files.model_path_second.empty() ||
@@ -318,15 +332,60 @@ void mnt_engine::create_model() {
             trg_vocab_file.assign(vocab_file);
         }
 
-        try {
-            *bergamot_ctx = m_bergamot_api_api.bergamot_api_make(
-                model_file.c_str(), src_vocab_file.c_str(),
-                trg_vocab_file.c_str(), shortlist_path.c_str(),
-                /*num_workers=*/1,
-                /*cache_size=*/500000, nullptr);
-        } catch (const std::exception& err) {
-            LOGE("error: " << err.what());
-        }
+        auto make = [&](size_t num_workers, size_t cache_size) -> void* {
+            try {
+                return m_bergamot_api_api.bergamot_api_make(
+                    model_file.c_str(), src_vocab_file.c_str(),
+                    trg_vocab_file.c_str(), shortlist_path.c_str(),
+                    num_workers, cache_size, nullptr);
+            } catch (const std::exception& err) {
+                LOGE("error: " << err.what());
+            }
+            return nullptr;
+        };
+
+        // number of workers is fixed when model is loaded, benchmark model
+        // has no translation cache, otherwise measured translation of the
+        // same text would be taken from cache after warmup
+        void* bench_ctx = nullptr;
+        int bench_workers = 0;
+
+        auto delete_bench_ctx = [&] {
+            if (bench_ctx) m_bergamot_api_api.bergamot_api_delete(bench_ctx);
+            bench_ctx = nullptr;
+            bench_workers = 0;
+        };
+
+        auto num_workers = thread_tuner::instance()->threads(
+            model_path, /*default_threads=*/1,
+            [&](int threads) {
+                if (bench_ctx && bench_workers == threads) return true;
+
+                delete_bench_ctx();
+
+                bench_ctx = make(threads, /*cache_size=*/0);
+                if (!bench_ctx) return false;
+
+                bench_workers = threads;
+
+                return true;
+            },
+            [&]([[maybe_unused]] int threads) {
+                try {
+                    m_bergamot_api_api.bergamot_api_translate(
+                        bench_ctx, bench_text().c_str(), false);
+                } catch (const std::exception& err) {
+                    LOGE("error: " << err.what());
+                    return false;
+                }
+                return true;
+            });
+
+        delete_bench_ctx();
+
+        LOGD("bergamot workers: " << num_workers);
+
+        *bergamot_ctx = make(num_workers, /*cache_size=*/500000);
 
         if (!*bergamot_ctx) LOGE("failed to make bergamot api");
     };
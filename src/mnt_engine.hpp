@@ -112,6 +112,7 @@ class mnt_engine {
     static std::string find_file_with_name_prefix(std::string dir_path,
                                                   std::string prefix);
 
+    static const std::string& bench_text();
     bool model_created() const;
     void create_model();
     void set_state(state_t new_state);
@@ -53,14 +53,20 @@ void piper_engine::create_model() {
 bool piper_engine::model_supports_speed() const { return true; }
 
 bool piper_engine::encode_speech_impl(const std::string& text,
-                                      const std::string& out_file) {
+                                      pcm_sink& sink) {
     auto length_scale =
         vits_length_scale(m_config.speech_speed, m_initial_length_scale);
 
     LOGD("length_scale: " << length_scale);
 
     try {
-        m_piper->text_to_wav_file(text, out_file, length_scale);
+        sink.set_format(m_piper->sample_rate(), 1);
+
+        m_piper->text_to_audio(
+            text, length_scale,
+            [&](const int16_t* samples, size_t size) {
+                sink.write(samples, size);
+            });
     } catch (const std::exception& err) {
         LOGE("error: " << err.what());
         return false;
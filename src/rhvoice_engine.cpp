@@ -80,13 +80,14 @@ void rhvoice_engine::create_model() {
 
 struct callback_data {
     rhvoice_engine* engine = nullptr;
-    std::ofstream wav_file;
+    tts_engine::pcm_sink* sink = nullptr;
 };
 
 int rhvoice_engine::set_sample_rate_callback(int sample_rate, void* user_data) {
     auto* cb_data = static_cast<callback_data*>(user_data);
 
     cb_data->engine->m_sample_rate = sample_rate;
+    cb_data->sink->set_format(sample_rate, 1);
 
     return 1;
 }
@@ -105,22 +106,17 @@ int rhvoice_engine::play_speech_callback(const short* samples,
         return 0;
     }
 
-    cb_data->wav_file.write(reinterpret_cast<const char*>(samples),
-                            count * sizeof(short));
+    cb_data->sink->write(samples, count);
 
     return 1;
 }
 
 bool rhvoice_engine::encode_speech_impl(const std::string& text,
-                                        const std::string& out_file) {
-    callback_data cb_data{this, std::ofstream{out_file, std::ios::binary}};
+                                        pcm_sink& sink) {
+    callback_data cb_data{this, &sink};
 
-    if (cb_data.wav_file.bad()) {
-        LOGE("failed to open file for writting: " << out_file);
-        return false;
-    }
-
-    cb_data.wav_file.seekp(sizeof(wav_header));
+    // updated by callback if voice has different sample rate
+    sink.set_format(m_sample_rate, 1);
 
     double rate = [this]() {
         if (m_config.speech_speed < 1 || m_config.speech_speed > 20 ||
@@ -149,43 +145,21 @@ bool rhvoice_engine::encode_speech_impl(const std::string& text,
                             RHVoice_message_text, &synth_params, &cb_data);
     if (!message) {
         LOGE("failed to create rhvoice message");
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
         return false;
     }
 
     if (RHVoice_speak(message) == 0) {
         LOGE("rhvoice speek failed");
         RHVoice_delete_message(message);
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
         return false;
     }
 
     RHVoice_delete_message(message);
 
-    if (m_shutting_down) {
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
-        return false;
-    }
-
-    auto data_size = cb_data.wav_file.tellp();
-
-    if (data_size == sizeof(wav_header)) {
-        LOGE("no audio data");
-        cb_data.wav_file.close();
-        unlink(out_file.c_str());
-        return false;
-    }
-
-    cb_data.wav_file.seekp(0);
+    if (m_shutting_down) return false;
 
     LOGD("sample rate: " << m_sample_rate);
 
-    write_wav_header(m_sample_rate, sizeof(short), 1, data_size / sizeof(short),
-                     cb_data.wav_file);
-
     LOGD("voice synthesized successfully");
 
     return true;
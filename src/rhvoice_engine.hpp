@@ -27,8 +27,7 @@ class rhvoice_engine : public tts_engine {
     bool model_created() const final;
     bool model_supports_speed() const final;
     void create_model() final;
-    bool encode_speech_impl(const std::string& text,
-                            const std::string& out_file) final;
+    bool encode_speech_impl(const std::string& text, pcm_sink& sink) final;
     static int play_speech_callback(const short* samples, unsigned int count,
                                     void* user_data);
     static int set_sample_rate_callback(int sample_rate, void* user_data);
@@ -0,0 +1,154 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Lock-free single-producer single-consumer ring buffer.
+ *
+ * Producer uses write_region/commit_write (or write), consumer uses
+ * read_region/commit_read (or read). Capacity is rounded up to a power of two.
+ * Head and tail are monotonic counters, so size is always head - tail.
+ */
+template <typename T>
+class ring_buffer {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "ring_buffer requires trivially copyable type");
+
+   public:
+    using value_type = T;
+
+    explicit ring_buffer(size_t capacity)
+        : m_buf(round_up_pow2(std::max<size_t>(capacity, 2))),
+          m_mask{m_buf.size() - 1} {}
+
+    ring_buffer(const ring_buffer&) = delete;
+    ring_buffer& operator=(const ring_buffer&) = delete;
+
+    inline size_t capacity() const { return m_buf.size(); }
+
+    inline size_t size() const {
+        return m_head.load(std::memory_order_acquire) -
+               m_tail.load(std::memory_order_acquire);
+    }
+
+    inline size_t free_size() const { return capacity() - size(); }
+    inline bool empty() const { return size() == 0; }
+    inline bool full() const { return size() == capacity(); }
+
+    // max number of elements that were stored at once since last reset
+    inline size_t high_water_mark() const {
+        return m_high_water_mark.load(std::memory_order_relaxed);
+    }
+
+    inline void reset_high_water_mark() {
+        m_high_water_mark.store(size(), std::memory_order_relaxed);
+    }
+
+    // producer side
+
+    // contiguous free space that can be filled before commit_write
+    std::pair<T*, size_t> write_region() {
+        auto head = m_head.load(std::memory_order_relaxed);
+        auto tail = m_tail.load(std::memory_order_acquire);
+
+        auto free = capacity() - (head - tail);
+        auto idx = head & m_mask;
+
+        return {m_buf.data() + idx, std::min(free, capacity() - idx)};
+    }
+
+    void commit_write(size_t count) {
+        auto head = m_head.load(std::memory_order_relaxed) + count;
+        m_head.store(head, std::memory_order_release);
+
+        auto new_size = head - m_tail.load(std::memory_order_acquire);
+        auto hwm = m_high_water_mark.load(std::memory_order_relaxed);
+        while (new_size > hwm && !m_high_water_mark.compare_exchange_weak(
+                                     hwm, new_size, std::memory_order_relaxed))
+            ;
+    }
+
+    size_t write(const T* data, size_t count) {
+        size_t done = 0;
+
+        while (done < count) {
+            auto [ptr, region_size] = write_region();
+            if (region_size == 0) break;
+
+            auto n = std::min(region_size, count - done);
+            std::memcpy(ptr, data + done, n * sizeof(T));
+            commit_write(n);
+            done += n;
+        }
+
+        return done;
+    }
+
+    // consumer side
+
+    // contiguous stored data that can be consumed before commit_read
+    std::pair<T*, size_t> read_region() {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        auto head = m_head.load(std::memory_order_acquire);
+
+        auto idx = tail & m_mask;
+
+        return {m_buf.data() + idx, std::min(head - tail, capacity() - idx)};
+    }
+
+    inline void commit_read(size_t count) {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + count,
+                     std::memory_order_release);
+    }
+
+    size_t read(T* data, size_t count) {
+        size_t done = 0;
+
+        while (done < count) {
+            auto [ptr, region_size] = read_region();
+            if (region_size == 0) break;
+
+            auto n = std::min(region_size, count - done);
+            std::memcpy(data + done, ptr, n * sizeof(T));
+            commit_read(n);
+            done += n;
+        }
+
+        return done;
+    }
+
+    // drops all stored data, must be called from consumer side
+    inline void clear() {
+        m_tail.store(m_head.load(std::memory_order_acquire),
+                     std::memory_order_release);
+    }
+
+   private:
+    std::vector<T> m_buf;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_head = 0;
+    alignas(64) std::atomic<size_t> m_tail = 0;
+    alignas(64) std::atomic<size_t> m_high_water_mark = 0;
+
+    static size_t round_up_pow2(size_t value) {
+        size_t pow2 = 1;
+        while (pow2 < value) pow2 <<= 1;
+        return pow2;
+    }
+};
+
+#endif  // RING_BUFFER_H
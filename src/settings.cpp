@@ -313,6 +313,146 @@ void settings::set_restore_punctuation(bool value) {
     }
 }
 
+bool settings::whisper_adaptive_audio_ctx() const {
+    return value(QStringLiteral("service/whisper_adaptive_audio_ctx"), true)
+        .toBool();
+}
+
+void settings::set_whisper_adaptive_audio_ctx(bool value) {
+    if (whisper_adaptive_audio_ctx() != value) {
+        setValue(QStringLiteral("service/whisper_adaptive_audio_ctx"), value);
+        emit whisper_adaptive_audio_ctx_changed();
+    }
+}
+
+unsigned int settings::stt_engine_pool_budget() const {
+    return std::min(
+        value(QStringLiteral("service/stt_engine_pool_budget"), 1024u).toUInt(),
+        65536u);
+}
+
+void settings::set_stt_engine_pool_budget(unsigned int value) {
+    value = std::min(value, 65536u);
+
+    if (stt_engine_pool_budget() != value) {
+        setValue(QStringLiteral("service/stt_engine_pool_budget"), value);
+        emit stt_engine_pool_budget_changed();
+    }
+}
+
+bool settings::whisper_streaming() const {
+    return value(QStringLiteral("service/whisper_streaming"), false).toBool();
+}
+
+void settings::set_whisper_streaming(bool value) {
+    if (whisper_streaming() != value) {
+        setValue(QStringLiteral("service/whisper_streaming"), value);
+        emit whisper_streaming_changed();
+    }
+}
+
+unsigned int settings::whisper_streaming_interval() const {
+    return std::clamp(
+        value(QStringLiteral("service/whisper_streaming_interval"), 1000u)
+            .toUInt(),
+        200u, 5000u);
+}
+
+void settings::set_whisper_streaming_interval(unsigned int value) {
+    value = std::clamp(value, 200u, 5000u);
+
+    if (whisper_streaming_interval() != value) {
+        setValue(QStringLiteral("service/whisper_streaming_interval"), value);
+        emit whisper_streaming_interval_changed();
+    }
+}
+
+unsigned int settings::vosk_partial_interval() const {
+    return std::clamp(
+        value(QStringLiteral("service/vosk_partial_interval"), 300u).toUInt(),
+        100u, 2000u);
+}
+
+void settings::set_vosk_partial_interval(unsigned int value) {
+    value = std::clamp(value, 100u, 2000u);
+
+    if (vosk_partial_interval() != value) {
+        setValue(QStringLiteral("service/vosk_partial_interval"), value);
+        emit vosk_partial_interval_changed();
+    }
+}
+
+settings::stt_vad_backend_t settings::stt_vad_backend() const {
+    return static_cast<stt_vad_backend_t>(
+        value(QStringLiteral("service/stt_vad_backend"),
+              static_cast<int>(stt_vad_backend_t::VadWebrtc))
+            .toInt());
+}
+
+void settings::set_stt_vad_backend(stt_vad_backend_t value) {
+    if (stt_vad_backend() != value) {
+        setValue(QStringLiteral("service/stt_vad_backend"),
+                 static_cast<int>(value));
+        emit stt_vad_backend_changed();
+    }
+}
+
+QString settings::stt_vad_model_file() const {
+    return value(QStringLiteral("service/stt_vad_model_file"), {}).toString();
+}
+
+void settings::set_stt_vad_model_file(const QString& value) {
+    if (stt_vad_model_file() != value) {
+        setValue(QStringLiteral("service/stt_vad_model_file"), value);
+        emit stt_vad_model_file_changed();
+    }
+}
+
+unsigned int settings::stt_vad_onset() const {
+    return std::clamp(
+        value(QStringLiteral("service/stt_vad_onset"), 750u).toUInt(), 90u,
+        1800u);
+}
+
+void settings::set_stt_vad_onset(unsigned int value) {
+    value = std::clamp(value, 90u, 1800u);
+
+    if (stt_vad_onset() != value) {
+        setValue(QStringLiteral("service/stt_vad_onset"), value);
+        emit stt_vad_onset_changed();
+    }
+}
+
+unsigned int settings::stt_vad_hangover() const {
+    return std::clamp(
+        value(QStringLiteral("service/stt_vad_hangover"), 300u).toUInt(), 90u,
+        3000u);
+}
+
+void settings::set_stt_vad_hangover(unsigned int value) {
+    value = std::clamp(value, 90u, 3000u);
+
+    if (stt_vad_hangover() != value) {
+        setValue(QStringLiteral("service/stt_vad_hangover"), value);
+        emit stt_vad_hangover_changed();
+    }
+}
+
+settings::resampler_quality_t settings::resampler_quality() const {
+    return static_cast<resampler_quality_t>(
+        value(QStringLiteral("service/resampler_quality"),
+              static_cast<int>(resampler_quality_t::ResamplerMedium))
+            .toInt());
+}
+
+void settings::set_resampler_quality(resampler_quality_t value) {
+    if (resampler_quality() != value) {
+        setValue(QStringLiteral("service/resampler_quality"),
+                 static_cast<int>(value));
+        emit resampler_quality_changed();
+    }
+}
+
 QString settings::py_path() const {
     return value(QStringLiteral("service/py_path"), {}).toString();
 }
@@ -203,6 +203,32 @@ class settings : public QSettings, public singleton<settings> {
                    set_cache_policy NOTIFY cache_policy_changed)
     Q_PROPERTY(int num_threads READ num_threads WRITE set_num_threads NOTIFY
                    num_threads_changed)
+    Q_PROPERTY(bool whisper_adaptive_audio_ctx READ whisper_adaptive_audio_ctx
+                   WRITE set_whisper_adaptive_audio_ctx NOTIFY
+                       whisper_adaptive_audio_ctx_changed)
+    Q_PROPERTY(unsigned int stt_engine_pool_budget READ stt_engine_pool_budget
+                   WRITE set_stt_engine_pool_budget NOTIFY
+                       stt_engine_pool_budget_changed)
+    Q_PROPERTY(bool whisper_streaming READ whisper_streaming WRITE
+                   set_whisper_streaming NOTIFY whisper_streaming_changed)
+    Q_PROPERTY(unsigned int whisper_streaming_interval READ
+                   whisper_streaming_interval WRITE
+                       set_whisper_streaming_interval NOTIFY
+                           whisper_streaming_interval_changed)
+    Q_PROPERTY(unsigned int vosk_partial_interval READ vosk_partial_interval
+                   WRITE set_vosk_partial_interval NOTIFY
+                       vosk_partial_interval_changed)
+    Q_PROPERTY(stt_vad_backend_t stt_vad_backend READ stt_vad_backend WRITE
+                   set_stt_vad_backend NOTIFY stt_vad_backend_changed)
+    Q_PROPERTY(QString stt_vad_model_file READ stt_vad_model_file WRITE
+                   set_stt_vad_model_file NOTIFY stt_vad_model_file_changed)
+    Q_PROPERTY(unsigned int stt_vad_onset READ stt_vad_onset WRITE
+                   set_stt_vad_onset NOTIFY stt_vad_onset_changed)
+    Q_PROPERTY(unsigned int stt_vad_hangover READ stt_vad_hangover WRITE
+                   set_stt_vad_hangover NOTIFY stt_vad_hangover_changed)
+    Q_PROPERTY(resampler_quality_t resampler_quality READ resampler_quality
+                   WRITE set_resampler_quality NOTIFY
+                       resampler_quality_changed)
     Q_PROPERTY(
         QString py_path READ py_path WRITE set_py_path NOTIFY py_path_changed)
     Q_PROPERTY(bool gpu_override_version READ gpu_override_version WRITE
@@ -254,6 +280,16 @@ class settings : public QSettings, public singleton<settings> {
     enum class cache_policy_t { CacheRemove = 0, CacheNoRemove = 1 };
     Q_ENUM(cache_policy_t)
 
+    enum class stt_vad_backend_t { VadWebrtc = 0, VadSilero = 1 };
+    Q_ENUM(stt_vad_backend_t)
+
+    enum class resampler_quality_t {
+        ResamplerFast = 0,
+        ResamplerMedium = 1,
+        ResamplerHigh = 2
+    };
+    Q_ENUM(resampler_quality_t)
+
     enum class audio_quality_t {
         AudioQualityVbrHigh = 10,
         AudioQualityVbrMedium = 11,
@@ -445,6 +481,26 @@ class settings : public QSettings, public singleton<settings> {
     void set_py_feature_scan(bool value);
     int num_threads() const;
     void set_num_threads(int value);
+    bool whisper_adaptive_audio_ctx() const;
+    void set_whisper_adaptive_audio_ctx(bool value);
+    unsigned int stt_engine_pool_budget() const;
+    void set_stt_engine_pool_budget(unsigned int value);
+    bool whisper_streaming() const;
+    void set_whisper_streaming(bool value);
+    unsigned int whisper_streaming_interval() const;
+    void set_whisper_streaming_interval(unsigned int value);
+    unsigned int vosk_partial_interval() const;
+    void set_vosk_partial_interval(unsigned int value);
+    stt_vad_backend_t stt_vad_backend() const;
+    void set_stt_vad_backend(stt_vad_backend_t value);
+    QString stt_vad_model_file() const;
+    void set_stt_vad_model_file(const QString &value);
+    unsigned int stt_vad_onset() const;
+    void set_stt_vad_onset(unsigned int value);
+    unsigned int stt_vad_hangover() const;
+    void set_stt_vad_hangover(unsigned int value);
+    resampler_quality_t resampler_quality() const;
+    void set_resampler_quality(resampler_quality_t value);
     QString py_path() const;
     void set_py_path(const QString &value);
 
@@ -555,6 +611,16 @@ class settings : public QSettings, public singleton<settings> {
     void cache_audio_format_changed();
     void cache_policy_changed();
     void num_threads_changed();
+    void whisper_adaptive_audio_ctx_changed();
+    void stt_engine_pool_budget_changed();
+    void whisper_streaming_changed();
+    void whisper_streaming_interval_changed();
+    void vosk_partial_interval_changed();
+    void stt_vad_backend_changed();
+    void stt_vad_model_file_changed();
+    void stt_vad_onset_changed();
+    void stt_vad_hangover_changed();
+    void resampler_quality_changed();
     void py_path_changed();
     void gpu_override_version_changed();
     void gpu_overrided_version_changed();
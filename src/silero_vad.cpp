@@ -0,0 +1,116 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "silero_vad.hpp"
+
+#include <algorithm>
+
+#include "dsp_tools.hpp"
+#include "logger.hpp"
+
+silero_vad::silero_vad(const std::string& model_file) {
+    Ort::SessionOptions options;
+    options.SetIntraOpNumThreads(1);
+    options.SetInterOpNumThreads(1);
+    options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+
+    m_session = Ort::Session{m_env, model_file.c_str(), options};
+    m_mem_info =
+        Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+
+    Ort::AllocatorWithDefaultOptions allocator;
+    for (size_t i = 0; i < m_session.GetInputCount(); ++i) {
+        if (std::string{m_session.GetInputNameAllocated(i, allocator).get()} ==
+            "state")
+            m_v5 = true;
+    }
+
+    // buffers must not be resized after tensors are created
+    if (m_v5) {
+        m_input.resize(m_context_size + m_chunk_size);
+        m_state.resize(2 * 128);
+        m_state_out.resize(m_state.size());
+
+        m_input_names = {"input", "state", "sr"};
+        m_output_names = {"output", "stateN"};
+
+        m_input_values.push_back(make_tensor(
+            m_input.data(), m_input.size(),
+            {1, static_cast<int64_t>(m_input.size())}));
+        m_input_values.push_back(
+            make_tensor(m_state.data(), m_state.size(), {2, 1, 128}));
+        m_input_values.push_back(make_tensor(m_sr.data(), m_sr.size(), {1}));
+
+        m_output_values.push_back(make_tensor(&m_prob, 1, {1, 1}));
+        m_output_values.push_back(
+            make_tensor(m_state_out.data(), m_state_out.size(), {2, 1, 128}));
+    } else {
+        m_input.resize(m_chunk_size);
+        m_state.resize(2 * 64);
+        m_state_out.resize(m_state.size());
+        m_state2.resize(m_state.size());
+        m_state2_out.resize(m_state.size());
+
+        m_input_names = {"input", "sr", "h", "c"};
+        m_output_names = {"output", "hn", "cn"};
+
+        m_input_values.push_back(make_tensor(
+            m_input.data(), m_input.size(),
+            {1, static_cast<int64_t>(m_input.size())}));
+        m_input_values.push_back(make_tensor(m_sr.data(), m_sr.size(), {1}));
+        m_input_values.push_back(
+            make_tensor(m_state.data(), m_state.size(), {2, 1, 64}));
+        m_input_values.push_back(
+            make_tensor(m_state2.data(), m_state2.size(), {2, 1, 64}));
+
+        m_output_values.push_back(make_tensor(&m_prob, 1, {1, 1}));
+        m_output_values.push_back(
+            make_tensor(m_state_out.data(), m_state_out.size(), {2, 1, 64}));
+        m_output_values.push_back(make_tensor(
+            m_state2_out.data(), m_state2_out.size(), {2, 1, 64}));
+    }
+
+    LOGD("silero vad created: model=" << model_file
+                                      << ", version=" << (m_v5 ? 5 : 4));
+}
+
+template <typename T>
+Ort::Value silero_vad::make_tensor(T* data, size_t size,
+                                   const std::vector<int64_t>& shape) const {
+    return Ort::Value::CreateTensor<T>(m_mem_info, data, size, shape.data(),
+                                       shape.size());
+}
+
+bool silero_vad::is_speech(const vad::buf_t::value_type* chunk) {
+    auto* input = m_input.data() + (m_v5 ? m_context_size : 0);
+
+    dsp_tools::s16_to_f32(chunk, input, m_chunk_size);
+
+    m_session.Run(Ort::RunOptions{nullptr}, m_input_names.data(),
+                  m_input_values.data(), m_input_values.size(),
+                  m_output_names.data(), m_output_values.data(),
+                  m_output_values.size());
+
+    std::copy(m_state_out.cbegin(), m_state_out.cend(), m_state.begin());
+    std::copy(m_state2_out.cbegin(), m_state2_out.cend(), m_state2.begin());
+
+    // v5 model expects tail of previous chunk before samples
+    if (m_v5)
+        std::copy(m_input.cend() - m_context_size, m_input.cend(),
+                  m_input.begin());
+
+    LOGT("silero prob: " << m_prob);
+
+    return m_prob > m_threshold;
+}
+
+void silero_vad::reset() {
+    std::fill(m_input.begin(), m_input.end(), 0.0F);
+    std::fill(m_state.begin(), m_state.end(), 0.0F);
+    std::fill(m_state2.begin(), m_state2.end(), 0.0F);
+    m_prob = 0.0F;
+}
@@ -0,0 +1,60 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef SILERO_VAD_H
+#define SILERO_VAD_H
+
+#include <onnxruntime_cxx_api.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "vad.hpp"
+
+/*
+ * Neural voice activity detector (https://github.com/snakers4/silero-vad)
+ * running on onnxruntime. Both v4 (h/c state) and v5 (single state with
+ * audio context) models are supported.
+ */
+class silero_vad : public vad::detector {
+   public:
+    explicit silero_vad(const std::string& model_file);
+    size_t chunk_size() const override { return m_chunk_size; }
+    bool is_speech(const vad::buf_t::value_type* chunk) override;
+    void reset() override;
+
+   private:
+    inline static const size_t m_chunk_size = 512;
+    inline static const size_t m_context_size = 64;  // v5 only
+    inline static const float m_threshold = 0.5F;
+
+    Ort::Env m_env{ORT_LOGGING_LEVEL_WARNING, "silero_vad"};
+    Ort::Session m_session{nullptr};
+    Ort::MemoryInfo m_mem_info{nullptr};
+    bool m_v5 = false;
+
+    // tensors are created once on top of these buffers
+    std::vector<float> m_input;
+    std::array<int64_t, 1> m_sr{16000};
+    std::vector<float> m_state;
+    std::vector<float> m_state_out;
+    std::vector<float> m_state2;  // v4 only
+    std::vector<float> m_state2_out;
+    float m_prob = 0.0F;
+
+    std::vector<const char*> m_input_names;
+    std::vector<const char*> m_output_names;
+    std::vector<Ort::Value> m_input_values;
+    std::vector<Ort::Value> m_output_values;
+
+    template <typename T>
+    Ort::Value make_tensor(T* data, size_t size,
+                           const std::vector<int64_t>& shape) const;
+};
+
+#endif  // SILERO_VAD_H
@@ -12,13 +12,20 @@
 #include <QCoreApplication>
 #include <QDBusConnection>
 #include <QDebug>
+#include <QDir>
+#include <QDirIterator>
 #include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <numeric>
 #include <optional>
 #include <set>
+#include <sstream>
 
 #include "april_engine.hpp"
 #include "coqui_engine.hpp"
@@ -37,6 +44,7 @@
 #include "rhvoice_engine.hpp"
 #include "settings.h"
 #include "text_tools.hpp"
+#include "thread_tuner.hpp"
 #include "vosk_engine.hpp"
 #include "whisper_engine.hpp"
 
@@ -139,9 +147,20 @@ static settings::audio_quality_t tts_audio_quality_from_options(
 }
 
 speech_service::speech_service(QObject *parent)
-    : QObject{parent}, m_dbus_service_adaptor{this} {
+    : QObject{parent},
+      m_stt_result_cache{QDir{settings::instance()->cache_dir()}.filePath(
+          QStringLiteral("stt_results"))},
+      m_dbus_service_adaptor{this} {
     qDebug() << "starting service:" << settings::instance()->launch_mode();
 
+    thread_tuner::instance()->set_cache_file(
+        QFileInfo{settings::instance()->fileName()}
+            .dir()
+            .filePath(QStringLiteral("thread_tuning"))
+            .toStdString());
+    thread_tuner::instance()->set_max_threads(
+        settings::instance()->num_threads());
+
     connect(models_manager::instance(), &models_manager::models_changed, this,
             &speech_service::handle_models_changed);
     connect(models_manager::instance(), &models_manager::busy_changed, this,
@@ -160,11 +179,11 @@ speech_service::speech_service(QObject *parent)
                 &speech_service::handle_stt_sentence_timeout),
             Qt::QueuedConnection);
     connect(this, &speech_service::stt_engine_eof, this,
-            static_cast<void (speech_service::*)(int)>(
+            static_cast<void (speech_service::*)(int, qulonglong)>(
                 &speech_service::handle_stt_engine_eof),
             Qt::QueuedConnection);
     connect(this, &speech_service::stt_engine_error, this,
-            static_cast<void (speech_service::*)(int)>(
+            static_cast<void (speech_service::*)(int, qulonglong)>(
                 &speech_service::handle_stt_engine_error),
             Qt::QueuedConnection);
     connect(this, &speech_service::tts_engine_error, this,
@@ -184,11 +203,32 @@ speech_service::speech_service(QObject *parent)
             Qt::QueuedConnection);
     connect(this, &speech_service::stt_engine_shutdown, this,
             [this] { stop_stt_engine(); });
+    connect(this, &speech_service::stt_engine_ready, this,
+            &speech_service::handle_stt_engine_ready, Qt::QueuedConnection);
+    connect(this, &speech_service::stt_engine_in_buf_space_available, this,
+            &speech_service::handle_audio_available, Qt::QueuedConnection);
+    connect(this, &speech_service::stt_engine_text_decoded, this,
+            &speech_service::handle_stt_engine_text_decoded,
+            Qt::QueuedConnection);
+    connect(settings::instance(), &settings::stt_engine_pool_budget_changed,
+            this, [this] { shrink_stt_engine_pool(); });
+    connect(settings::instance(), &settings::num_threads_changed, this, [] {
+        thread_tuner::instance()->set_max_threads(
+            settings::instance()->num_threads());
+    });
     connect(
         this, &speech_service::requet_update_task_state, this,
         [this] { update_task_state(); }, Qt::QueuedConnection);
-    connect(&m_player, &QMediaPlayer::stateChanged, this,
+    connect(&m_player, &tts_player::state_changed, this,
             &speech_service::handle_player_state_changed, Qt::QueuedConnection);
+    // player lives in the same thread, direct connection guarantees that
+    // segment events are not delivered after player has been stopped
+    connect(&m_player, &tts_player::segment_started, this,
+            &speech_service::handle_player_segment_started,
+            Qt::DirectConnection);
+    connect(&m_player, &tts_player::segment_finished, this,
+            &speech_service::handle_player_segment_finished,
+            Qt::DirectConnection);
     connect(
         settings::instance(), &settings::default_stt_model_changed, this,
         [this]() {
@@ -505,7 +545,11 @@ speech_service::speech_service(QObject *parent)
     features_availability();
 }
 
-speech_service::~speech_service() { qDebug() << "speech service dtor"; }
+speech_service::~speech_service() {
+    qDebug() << "speech service dtor";
+
+    save_checkpoint();
+}
 
 speech_service::source_t speech_service::audio_source_type() const {
     if (!m_source) return source_t::none;
@@ -961,6 +1005,12 @@ speech_service::choose_model_config(engine_t engine_type,
 void speech_service::handle_models_changed() {
     fill_available_models_map(models_manager::instance()->available_models());
 
+    // drop pooled engines of removed models
+    m_stt_engine_pool.remove_if([](const auto &pooled) {
+        return !QFileInfo::exists(
+            QString::fromStdString(pooled.engine->model_files().model_file));
+    });
+
     if (m_current_task &&
         (m_available_stt_models_map.find(m_current_task->model_id) ==
              m_available_stt_models_map.end() ||
@@ -1023,141 +1073,390 @@ static std::optional<typename Engine::gpu_device_t> make_gpu_device(
     return std::nullopt;
 }
 
+static bool stt_engine_matches(const stt_engine &engine,
+                               models_manager::model_engine_t engine_type,
+                               const stt_engine::config_t &config) {
+    const auto &type = typeid(engine);
+    if (engine_type == models_manager::model_engine_t::stt_ds &&
+        type != typeid(ds_engine))
+        return false;
+    if (engine_type == models_manager::model_engine_t::stt_vosk &&
+        type != typeid(vosk_engine))
+        return false;
+    if (engine_type == models_manager::model_engine_t::stt_whisper &&
+        type != typeid(whisper_engine))
+        return false;
+    if (engine_type == models_manager::model_engine_t::stt_fasterwhisper &&
+        type != typeid(fasterwhisper_engine))
+        return false;
+    if (engine_type == models_manager::model_engine_t::stt_april &&
+        type != typeid(april_engine))
+        return false;
+
+    if (engine.model_files() != config.model_files) return false;
+    if (engine.lang() != config.lang) return false;
+    if (engine.translate() != config.translate) return false;
+    if (engine.adaptive_audio_ctx() != config.adaptive_audio_ctx) return false;
+    if (engine.streaming() !=
+        std::make_pair(config.streaming, config.streaming_interval_ms))
+        return false;
+    if (engine.partial_interval() != config.partial_interval_ms) return false;
+    if (engine.vad_backend() !=
+        std::make_pair(config.vad_backend, config.vad_model_file))
+        return false;
+    if (engine.vad_timing() !=
+        std::make_pair(config.vad_onset_ms, config.vad_hangover_ms))
+        return false;
+    if (config.use_gpu != engine.use_gpu() ||
+        config.gpu_device != engine.gpu_device())
+        return false;
+    return true;
+}
+
+// size of model files, approximation of memory used by loaded model
+static size_t stt_model_files_size(
+    const stt_engine::model_files_t &model_files) {
+    size_t size = 0;
+
+    for (const auto &file :
+         {model_files.model_file, model_files.scorer_file,
+          model_files.ttt_model_file}) {
+        if (file.empty()) continue;
+
+        QFileInfo info{QString::fromStdString(file)};
+
+        if (info.isDir()) {
+            QDirIterator it{info.filePath(), QDir::Files,
+                            QDirIterator::Subdirectories};
+            while (it.hasNext()) {
+                it.next();
+                size += it.fileInfo().size();
+            }
+        } else {
+            size += info.size();
+        }
+    }
+
+    return size;
+}
+
+void speech_service::return_stt_engine_to_pool(
+    std::unique_ptr<stt_engine> &engine) {
+    if (!engine) return;
+
+    // source must not write to engine that is no longer current
+    if (m_source && &engine == &m_stt_engine) m_source->attach_sink(nullptr);
+
+    // gpu memory is usually too small to keep many models loaded
+    if (engine->use_gpu()) {
+        engine.reset();
+        qDebug() << "stt engine destroyed successfully";
+        return;
+    }
+
+    engine->stop();
+
+    auto mem_size = stt_model_files_size(engine->model_files());
+
+    qDebug() << "stt engine returned to pool:" << mem_size / (1024 * 1024)
+             << "MB";
+
+    m_stt_engine_pool.push_front({std::move(engine), mem_size});
+
+    shrink_stt_engine_pool();
+}
+
+std::unique_ptr<stt_engine> speech_service::take_stt_engine_from_pool(
+    models_manager::model_engine_t engine_type,
+    const stt_engine::config_t &config) {
+    auto it = std::find_if(
+        m_stt_engine_pool.begin(), m_stt_engine_pool.end(),
+        [&](const auto &pooled) {
+            return stt_engine_matches(*pooled.engine, engine_type, config);
+        });
+
+    if (it == m_stt_engine_pool.end()) return {};
+
+    auto engine = std::move(it->engine);
+    m_stt_engine_pool.erase(it);
+
+    return engine;
+}
+
+void speech_service::shrink_stt_engine_pool() {
+    size_t budget =
+        static_cast<size_t>(settings::instance()->stt_engine_pool_budget()) *
+        1024 * 1024;
+
+    size_t total = 0;
+
+    for (auto it = m_stt_engine_pool.begin(); it != m_stt_engine_pool.end();) {
+        total += it->mem_size;
+
+        if (total > budget) {
+            qDebug() << "stt engine removed from pool:"
+                     << it->mem_size / (1024 * 1024) << "MB";
+            total -= it->mem_size;
+            it = m_stt_engine_pool.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::unique_ptr<stt_engine> speech_service::make_stt_engine(
+    models_manager::model_engine_t engine_type, stt_engine::config_t config) {
+    // eof and errors are tagged with engine id because previous engine can
+    // be still decoding and next one loading model at the same time, ids are
+    // never reused so late callback of destroyed engine doesn't match any
+    // engine
+    auto id = ++m_last_stt_engine_id;
+
+    stt_engine::callbacks_t call_backs{
+        /*text_decoded=*/
+        [this](const std::string &text, size_t samples_decoded) {
+            handle_stt_text_decoded(text, samples_decoded);
+        },
+        /*intermediate_text_decoded=*/
+        [this](const std::string &text) {
+            handle_stt_intermediate_text_decoded(text);
+        },
+        /*speech_detection_status_changed=*/
+        [this](stt_engine::speech_detection_status_t status) {
+            handle_stt_speech_detection_status_changed(status);
+        },
+        /*sentence_timeout=*/
+        [this]() { handle_stt_sentence_timeout(); },
+        /*eof=*/
+        [this, id]() { handle_stt_engine_eof(id); },
+        /*stopped=*/
+        [this, id]() { handle_stt_engine_error(id); },
+        /*ready=*/
+        [this]() { emit stt_engine_ready(); },
+        /*in_buf_space_available=*/
+        [this]() { emit stt_engine_in_buf_space_available(); }};
+
+    std::unique_ptr<stt_engine> engine;
+
+    switch (engine_type) {
+        case models_manager::model_engine_t::stt_ds:
+            engine = std::make_unique<ds_engine>(std::move(config),
+                                                 std::move(call_backs));
+            break;
+        case models_manager::model_engine_t::stt_vosk:
+            engine = std::make_unique<vosk_engine>(std::move(config),
+                                                   std::move(call_backs));
+            break;
+        case models_manager::model_engine_t::stt_whisper:
+            engine = std::make_unique<whisper_engine>(std::move(config),
+                                                      std::move(call_backs));
+            break;
+        case models_manager::model_engine_t::stt_fasterwhisper:
+            engine = std::make_unique<fasterwhisper_engine>(
+                std::move(config), std::move(call_backs));
+            break;
+        case models_manager::model_engine_t::stt_april:
+            engine = std::make_unique<april_engine>(std::move(config),
+                                                    std::move(call_backs));
+            break;
+        case models_manager::model_engine_t::ttt_hftc:
+        case models_manager::model_engine_t::tts_coqui:
+        case models_manager::model_engine_t::tts_piper:
+        case models_manager::model_engine_t::tts_espeak:
+        case models_manager::model_engine_t::tts_rhvoice:
+        case models_manager::model_engine_t::tts_mimic3:
+        case models_manager::model_engine_t::mnt_bergamot:
+            throw std::runtime_error{"invalid model engine, expected stt"};
+    }
+
+    engine->set_id(id);
+
+    return engine;
+}
+
+void speech_service::handle_stt_engine_ready() {
+    if (!m_stt_engine_next || !m_stt_engine_next->ready()) {
+        // audio was not read while engine was initializing
+        handle_audio_available();
+        return;
+    }
+
+    qDebug() << "switching to stt engine loaded in background";
+
+    auto speech_started = m_stt_engine && m_stt_engine->speech_status();
+    auto offline_mode = m_stt_engine && m_stt_engine->offline_mode();
+    auto stt_active = m_current_task && m_current_task->engine == engine_t::stt;
+
+    if (stt_active)
+        drain_stt_engine(m_stt_engine);
+    else
+        return_stt_engine_to_pool(m_stt_engine);
+
+    m_stt_engine = std::move(m_stt_engine_next);
+
+    if (stt_active) {
+        m_stt_engine->set_offline_mode(offline_mode);
+        m_stt_engine->set_speech_started(speech_started);
+    } else {
+        // stt was stopped while new engine was loading
+        m_stt_engine->stop();
+    }
+
+    update_task_state();
+    handle_audio_available();
+}
+
+void speech_service::drain_stt_engine(std::unique_ptr<stt_engine> &engine) {
+    if (!engine) return;
+
+    // source writes only to engine that replaces this one
+    if (m_source) m_source->attach_sink(nullptr);
+
+    if (!engine->started()) {
+        return_stt_engine_to_pool(engine);
+        return;
+    }
+
+    return_stt_engine_to_pool(m_stt_engine_draining);
+
+    qDebug() << "draining previous stt engine";
+
+    // audio already queued is decoded with previous model, engine is returned
+    // to pool when it reports eof
+    engine->drain();
+    m_stt_engine_draining = std::move(engine);
+}
+
+QString speech_service::make_stt_engine_params(
+    const model_config_t &model_config, const QString &out_lang_id) {
+    auto config = make_stt_engine_config(model_config, speech_mode_t::automatic,
+                                         out_lang_id);
+
+    // device doesn't change decoded text
+    config.use_gpu = false;
+    config.gpu_device = {};
+
+    std::ostringstream os;
+    os << model_config.stt->model_id.toStdString() << ", " << config;
+
+    return QString::fromStdString(os.str());
+}
+
+stt_engine::config_t speech_service::make_stt_engine_config(
+    const model_config_t &model_config, speech_mode_t speech_mode,
+    const QString &out_lang_id) {
+    stt_engine::config_t config;
+
+    config.model_files.model_file = model_config.stt->model_file.toStdString();
+    config.model_files.scorer_file =
+        model_config.stt->scorer_file.toStdString();
+    if (model_config.stt->ttt)
+        config.model_files.ttt_model_file =
+            model_config.stt->ttt->model_file.toStdString();
+    config.lang = model_config.stt->lang_id.toStdString();
+    config.lang_code = model_config.stt->lang_code.toStdString();
+    config.speech_mode = static_cast<stt_engine::speech_mode_t>(speech_mode);
+    config.translate =
+        !out_lang_id.isEmpty() && out_lang_id == "en" && config.lang != "en";
+    config.options = model_config.options.toStdString();
+    config.adaptive_audio_ctx =
+        settings::instance()->whisper_adaptive_audio_ctx();
+    config.streaming = settings::instance()->whisper_streaming();
+    config.streaming_interval_ms =
+        settings::instance()->whisper_streaming_interval();
+    if (settings::instance()->stt_vad_backend() ==
+        settings::stt_vad_backend_t::VadSilero) {
+        config.vad_backend = stt_engine::vad_backend_t::silero;
+        auto vad_model_file = settings::instance()->stt_vad_model_file();
+        if (vad_model_file.isEmpty())
+            vad_model_file = QDir{settings::instance()->models_dir()}
+                                 .filePath(QStringLiteral("silero_vad.onnx"));
+        config.vad_model_file = vad_model_file.toStdString();
+    }
+    config.partial_interval_ms = settings::instance()->vosk_partial_interval();
+    config.vad_onset_ms = settings::instance()->stt_vad_onset();
+    config.vad_hangover_ms = settings::instance()->stt_vad_hangover();
+
+    if (settings::instance()->stt_use_gpu() &&
+        settings::instance()->has_gpu_device_stt()) {
+        if (auto device = make_gpu_device<stt_engine>(
+                settings::instance()->gpu_device_stt(),
+                settings::instance()->auto_gpu_device_stt())) {
+            config.gpu_device = std::move(*device);
+            config.use_gpu = true;
+        }
+    }
+
+    return config;
+}
+
 QString speech_service::restart_stt_engine(speech_mode_t speech_mode,
                                            const QString &model_id,
                                            const QString &out_lang_id) {
     auto model_config = choose_model_config(engine_t::stt, model_id);
     if (model_config && model_config->stt) {
-        stt_engine::config_t config;
-
-        config.model_files.model_file =
-            model_config->stt->model_file.toStdString();
-        config.model_files.scorer_file =
-            model_config->stt->scorer_file.toStdString();
-        if (model_config->stt->ttt)
-            config.model_files.ttt_model_file =
-                model_config->stt->ttt->model_file.toStdString();
-        config.lang = model_config->stt->lang_id.toStdString();
-        config.lang_code = model_config->stt->lang_code.toStdString();
-        config.speech_mode =
-            static_cast<stt_engine::speech_mode_t>(speech_mode);
-        config.translate = !out_lang_id.isEmpty() && out_lang_id == "en" &&
-                           config.lang != "en";
-        config.options = model_config->options.toStdString();
+        auto config =
+            make_stt_engine_config(*model_config, speech_mode, out_lang_id);
 
-        if (settings::instance()->stt_use_gpu() &&
-            settings::instance()->has_gpu_device_stt()) {
-            if (auto device = make_gpu_device<stt_engine>(
-                    settings::instance()->gpu_device_stt(),
-                    settings::instance()->auto_gpu_device_stt())) {
-                config.gpu_device = std::move(*device);
-                config.use_gpu = true;
-            }
-        }
-
-        bool new_engine_required = [&] {
-            if (!m_stt_engine) return true;
+        bool new_engine_required =
+            !m_stt_engine ||
+            !stt_engine_matches(*m_stt_engine, model_config->stt->engine,
+                                config);
 
-            const auto &type = typeid(*m_stt_engine);
-            if (model_config->stt->engine ==
-                    models_manager::model_engine_t::stt_ds &&
-                type != typeid(ds_engine))
-                return true;
-            if (model_config->stt->engine ==
-                    models_manager::model_engine_t::stt_vosk &&
-                type != typeid(vosk_engine))
-                return true;
-            if (model_config->stt->engine ==
-                    models_manager::model_engine_t::stt_whisper &&
-                type != typeid(whisper_engine))
-                return true;
-            if (model_config->stt->engine ==
-                    models_manager::model_engine_t::stt_fasterwhisper &&
-                type != typeid(fasterwhisper_engine))
-                return true;
-            if (model_config->stt->engine ==
-                    models_manager::model_engine_t::stt_april &&
-                type != typeid(april_engine))
-                return true;
+        qDebug() << "restart stt engine config:" << config;
 
-            if (m_stt_engine->model_files() != config.model_files) return true;
-            if (m_stt_engine->lang() != config.lang) return true;
-            if (m_stt_engine->translate() != config.translate) return true;
-            if (config.use_gpu != m_stt_engine->use_gpu() ||
-                config.gpu_device != m_stt_engine->gpu_device())
-                return true;
-            return false;
-        }();
+        if (m_stt_engine_next) {
+            if (stt_engine_matches(*m_stt_engine_next,
+                                   model_config->stt->engine, config)) {
+                qDebug() << "stt engine already loading in background";
+                m_stt_engine_next->set_speech_mode(
+                    static_cast<stt_engine::speech_mode_t>(speech_mode));
+                return model_config->stt->model_id;
+            }
 
-        qDebug() << "restart stt engine config:" << config;
+            return_stt_engine_to_pool(m_stt_engine_next);
+        }
 
         if (new_engine_required) {
             qDebug() << "new stt engine required";
 
-            if (m_stt_engine) {
-                m_stt_engine.reset();
-                qDebug() << "stt engine destroyed successfully";
-            }
+            // current engine keeps serving until new one has loaded model
+            bool hot_swap = m_stt_engine && m_stt_engine->started();
 
-            stt_engine::callbacks_t call_backs{
-                /*text_decoded=*/[this](const std::string &text) {
-                    handle_stt_text_decoded(text);
-                },
-                /*intermediate_text_decoded=*/
-                [this](const std::string &text) {
-                    handle_stt_intermediate_text_decoded(text);
-                },
-                /*speech_detection_status_changed=*/
-                [this](stt_engine::speech_detection_status_t status) {
-                    handle_stt_speech_detection_status_changed(status);
-                },
-                /*sentence_timeout=*/
-                [this]() { handle_stt_sentence_timeout(); },
-                /*eof=*/
-                [this]() { handle_stt_engine_eof(); },
-                /*stopped=*/
-                [this]() { handle_stt_engine_error(); }};
+            if (!hot_swap) return_stt_engine_to_pool(m_stt_engine);
 
-            try {
-                switch (model_config->stt->engine) {
-                    case models_manager::model_engine_t::stt_ds:
-                        m_stt_engine = std::make_unique<ds_engine>(
-                            std::move(config), std::move(call_backs));
-                        break;
-                    case models_manager::model_engine_t::stt_vosk:
-                        m_stt_engine = std::make_unique<vosk_engine>(
-                            std::move(config), std::move(call_backs));
-                        break;
-                    case models_manager::model_engine_t::stt_whisper:
-                        m_stt_engine = std::make_unique<whisper_engine>(
-                            std::move(config), std::move(call_backs));
-                        break;
-                    case models_manager::model_engine_t::stt_fasterwhisper:
-                        m_stt_engine = std::make_unique<fasterwhisper_engine>(
-                            std::move(config), std::move(call_backs));
-                        break;
-                    case models_manager::model_engine_t::stt_april:
-                        m_stt_engine = std::make_unique<april_engine>(
-                            std::move(config), std::move(call_backs));
-                        break;
-                    case models_manager::model_engine_t::ttt_hftc:
-                    case models_manager::model_engine_t::tts_coqui:
-                    case models_manager::model_engine_t::tts_piper:
-                    case models_manager::model_engine_t::tts_espeak:
-                    case models_manager::model_engine_t::tts_rhvoice:
-                    case models_manager::model_engine_t::tts_mimic3:
-                    case models_manager::model_engine_t::mnt_bergamot:
-                        throw std::runtime_error{
-                            "invalid model engine, expected stt"};
+            auto engine =
+                take_stt_engine_from_pool(model_config->stt->engine, config);
+
+            if (engine) {
+                qDebug() << "reusing stt engine from pool";
+                engine->set_speech_mode(
+                    static_cast<stt_engine::speech_mode_t>(speech_mode));
+            } else {
+                try {
+                    engine = make_stt_engine(model_config->stt->engine,
+                                             std::move(config));
+                } catch (const std::runtime_error &error) {
+                    qWarning()
+                        << "failed to create stt engine:" << error.what();
+                    return {};
                 }
-            } catch (const std::runtime_error &error) {
-                qWarning() << "failed to create stt engine:" << error.what();
-                return {};
             }
 
-            m_stt_engine->start();
+            engine->start();
+
+            if (hot_swap) {
+                qDebug() << "stt engine loading in background";
+                m_stt_engine->set_speech_mode(
+                    static_cast<stt_engine::speech_mode_t>(speech_mode));
+                m_stt_engine_next = std::move(engine);
+            } else {
+                m_stt_engine = std::move(engine);
+            }
         } else {
             qDebug() << "new stt engine not required, only restart";
+            // decoder must not write to engine while its buffers are reset
+            if (m_source) m_source->attach_sink(nullptr);
             m_stt_engine->stop();
             m_stt_engine->start();
             m_stt_engine->set_speech_mode(
@@ -1492,6 +1791,8 @@ void speech_service::handle_stt_intermediate_text_decoded(
 
 void speech_service::handle_stt_text_decoded(const QString &, const QString &,
                                              int task_id) {
+    if (current_task_id() == task_id) update_file_progress();
+
     if (m_current_task && m_current_task->id == task_id &&
         m_current_task->speech_mode == speech_mode_t::single_sentence) {
         stt_stop_listen(m_current_task->id);
@@ -1509,18 +1810,70 @@ void speech_service::handle_stt_sentence_timeout() {
     }
 }
 
-void speech_service::handle_stt_engine_eof(int task_id) {
+uint64_t speech_service::stt_engine_id(
+    const std::unique_ptr<stt_engine> &engine) {
+    return engine ? engine->id() : 0;
+}
+
+void speech_service::handle_stt_engine_eof(int task_id,
+                                           qulonglong engine_id) {
+    if (m_stt_engine_draining &&
+        engine_id == stt_engine_id(m_stt_engine_draining)) {
+        qDebug() << "previous stt engine drained";
+        return_stt_engine_to_pool(m_stt_engine_draining);
+        return;
+    }
+
+    if (task_id == INVALID_TASK ||
+        engine_id != stt_engine_id(m_stt_engine)) {
+        qDebug() << "ignoring eof of inactive stt engine";
+        return;
+    }
+
     qDebug() << "engine eof";
-    if (audio_source_type() == source_t::file)
+    if (audio_source_type() == source_t::file) {
+        // whole file has been transcribed, nothing to resume
+        if (m_checkpoint && m_checkpoint_task == task_id) {
+            m_stt_result_cache.put(m_stt_result_cache_key,
+                                   m_checkpoint->texts());
+            m_checkpoint->remove();
+            m_checkpoint.reset();
+            m_checkpoint_task = INVALID_TASK;
+        }
         emit stt_file_transcribe_finished(task_id);
+    }
     cancel(task_id);
 }
 
-void speech_service::handle_stt_engine_eof() {
-    if (m_current_task) emit stt_engine_eof(m_current_task->id);
+void speech_service::handle_stt_engine_eof(qulonglong engine_id) {
+    // emitted also without task, draining engine is returned to pool anyway
+    emit stt_engine_eof(current_task_id(), engine_id);
 }
 
-void speech_service::handle_stt_engine_error(int task_id) {
+void speech_service::handle_stt_engine_error(int task_id,
+                                             qulonglong engine_id) {
+    if (m_stt_engine_next && engine_id == stt_engine_id(m_stt_engine_next)) {
+        // current engine keeps serving the task
+        qWarning() << "stt engine loading in background failed";
+        m_stt_engine_next.reset();
+        emit error(error_t::stt_engine);
+        handle_audio_available();
+        return;
+    }
+
+    if (m_stt_engine_draining &&
+        engine_id == stt_engine_id(m_stt_engine_draining)) {
+        qWarning() << "previous stt engine failed while draining";
+        m_stt_engine_draining.reset();
+        return;
+    }
+
+    if (task_id == INVALID_TASK ||
+        engine_id != stt_engine_id(m_stt_engine)) {
+        qDebug() << "ignoring error of inactive stt engine";
+        return;
+    }
+
     qDebug() << "stt engine error";
 
     emit error(error_t::stt_engine);
@@ -1528,14 +1881,16 @@ void speech_service::handle_stt_engine_error(int task_id) {
     if (current_task_id() == task_id) {
         cancel(task_id);
         if (m_stt_engine) {
+            if (m_source) m_source->attach_sink(nullptr);
             m_stt_engine.reset();
             qDebug() << "stt engine destroyed successfully";
         }
+        m_stt_engine_next.reset();
     }
 }
 
-void speech_service::handle_stt_engine_error() {
-    if (m_current_task) emit stt_engine_error(m_current_task->id);
+void speech_service::handle_stt_engine_error(qulonglong engine_id) {
+    emit stt_engine_error(current_task_id(), engine_id);
 }
 
 void speech_service::handle_tts_engine_error(int task_id) {
@@ -1546,6 +1901,7 @@ void speech_service::handle_tts_engine_error(int task_id) {
     if (current_task_id() == task_id) {
         cancel(task_id);
         if (m_stt_engine) {
+            if (m_source) m_source->attach_sink(nullptr);
             m_stt_engine.reset();
             qDebug() << "tts engine destroyed successfully";
         }
@@ -1590,7 +1946,6 @@ void speech_service::handle_tts_speech_encoded(
             {/*text=*/QString::fromStdString(text),
              /*audio_file_path=*/QString::fromStdString(audio_file_path),
              /*audio_format=*/format,
-             /*remove_ausio_file=*/false,
              /*last=*/last,
              /*task_id=*/m_current_task->id});
     }
@@ -1658,6 +2013,20 @@ static media_compressor::quality_t media_quality_from_audio_quality(
     return media_compressor::quality_t::vbr_medium;
 }
 
+static media_compressor::resampler_t media_resampler_from_resampler_quality(
+    settings::resampler_quality_t quality) {
+    switch (quality) {
+        case settings::resampler_quality_t::ResamplerFast:
+            return media_compressor::resampler_t::swr_fast;
+        case settings::resampler_quality_t::ResamplerMedium:
+            return media_compressor::resampler_t::swr_medium;
+        case settings::resampler_quality_t::ResamplerHigh:
+            return media_compressor::resampler_t::swr_high;
+    }
+
+    return media_compressor::resampler_t::swr_medium;
+}
+
 static QString merged_file_path(const std::vector<QString> &files) {
     return QStringLiteral("%1/merged-%2")
         .arg(settings::instance()->cache_dir(),
@@ -1748,6 +2117,10 @@ void speech_service::handle_speech_to_file(const tts_partial_result_t &result) {
 void speech_service::handle_tts_speech_encoded(tts_partial_result_t result) {
     if (m_current_task && m_current_task->id == result.task_id) {
         if (m_current_task->speech_mode == speech_mode_t::play_speech) {
+            // audio is queued in player right away, so it can be decoded
+            // while previous sentence is playing
+            if (!result.audio_file_path.isEmpty())
+                m_player.enqueue(result.audio_file_path, result.audio_format);
             m_tts_queue.push(std::move(result));
             handle_tts_queue();
         } else {
@@ -1759,55 +2132,33 @@ void speech_service::handle_tts_speech_encoded(tts_partial_result_t result) {
 }
 
 void speech_service::handle_tts_queue() {
-    if (m_tts_queue.empty()) return;
-
-    if (m_player.state() == QMediaPlayer::State::PlayingState ||
-        m_player.state() == QMediaPlayer::State::PausedState)
-        return;
-
     if (m_current_task && m_current_task->paused) return;
 
-    auto &result = m_tts_queue.front();
-
-    if (!result.audio_file_path.isEmpty()) {
-        if (result.audio_format != tts_engine::audio_format_t::wav) {
-            auto audio_file_wav = result.audio_file_path + ".wav";
-            media_compressor{}.decompress(
-                {result.audio_file_path.toStdString()},
-                audio_file_wav.toStdString(),
-                /*mono_16khz=*/false);
-            result.audio_file_path = std::move(audio_file_wav);
-            result.audio_format = tts_engine::audio_format_t::wav;
-            result.remove_audio_file = true;
-        }
-
-        m_player.setMedia(
-            QMediaContent{QUrl::fromLocalFile(result.audio_file_path)});
-
-        m_player.play();
-
-        emit tts_partial_speech_playing(result.text, result.task_id);
-    } else if (result.last) {
-        auto task = result.task_id;
+    // results without audio are consumed when audio queued before them has
+    // been played
+    while (!m_tts_queue.empty() &&
+           m_tts_queue.front().audio_file_path.isEmpty()) {
+        auto result = std::move(m_tts_queue.front());
+        m_tts_queue.pop();
 
-        tts_stop_speech(task);
-        if (m_tts_queue.empty()) {
-            emit tts_partial_speech_playing("", task);
-        } else {
-            if (result.remove_audio_file) QFile::remove(result.audio_file_path);
-            m_tts_queue.pop();
-        }
-        emit tts_play_speech_finished(task);
-    } else {
-        if (!m_tts_queue.empty()) {
-            if (result.remove_audio_file) QFile::remove(result.audio_file_path);
-            m_tts_queue.pop();
+        if (result.last) {
+            finish_tts_speech(result.task_id);
+            return;
         }
-
-        handle_tts_queue();
     }
 }
 
+void speech_service::finish_tts_speech(int task) {
+    // player is not stopped, it stops audio output by itself when end of
+    // last segment has been played
+    stop_keepalive_current_task();
+    stop_tts_engine();
+    clean_tts_queue();
+
+    emit tts_partial_speech_playing("", task);
+    emit tts_play_speech_finished(task);
+}
+
 void speech_service::handle_tts_engine_error() {
     if (m_current_task) emit tts_engine_error(m_current_task->id);
 }
@@ -1830,7 +2181,8 @@ void speech_service::handle_mnt_engine_error(int task_id) {
     }
 }
 
-void speech_service::handle_stt_text_decoded(const std::string &text) {
+void speech_service::handle_stt_text_decoded(const std::string &text,
+                                             size_t samples_decoded) {
     if (m_current_task) {
         if (m_previous_task &&
             m_last_intermediate_text_task == m_previous_task->id) {
@@ -1840,6 +2192,10 @@ void speech_service::handle_stt_text_decoded(const std::string &text) {
         } else {
             emit stt_text_decoded(QString::fromStdString(text),
                                   m_current_task->model_id, m_current_task->id);
+            // 16 samples per ms
+            emit stt_engine_text_decoded(QString::fromStdString(text),
+                                         samples_decoded / 16,
+                                         m_current_task->id);
         }
     } else {
         qWarning() << "current task does not exist";
@@ -1848,45 +2204,58 @@ void speech_service::handle_stt_text_decoded(const std::string &text) {
     m_previous_task.reset();
 }
 
+void speech_service::handle_stt_engine_text_decoded(const QString &text,
+                                                    qulonglong decoded_ms,
+                                                    int task_id) {
+    if (m_checkpoint && m_checkpoint_task == task_id)
+        m_checkpoint->add_text(text, decoded_ms);
+}
+
+void speech_service::save_checkpoint() {
+    if (!m_checkpoint) return;
+
+    m_checkpoint->save();
+    m_checkpoint.reset();
+    m_checkpoint_task = INVALID_TASK;
+    m_stt_result_cache_key.clear();
+}
+
 void speech_service::handle_stt_speech_detection_status_changed(
     [[maybe_unused]] stt_engine::speech_detection_status_t status) {
     update_task_state();
 }
 
-void speech_service::handle_player_state_changed(
-    QMediaPlayer::State new_state) {
-    qDebug() << "player new state:" << new_state;
-
+void speech_service::handle_player_state_changed() {
     update_task_state();
+}
 
-    if (new_state == QMediaPlayer::State::StoppedState && m_current_task &&
-        m_current_task->engine == engine_t::tts && !m_current_task->paused &&
-        !m_tts_queue.empty()) {
-        const auto &result = m_tts_queue.front();
+void speech_service::handle_player_segment_started() {
+    if (!m_current_task || m_current_task->engine != engine_t::tts ||
+        m_tts_queue.empty())
+        return;
 
-        auto task = result.task_id;
+    const auto &result = m_tts_queue.front();
 
-        if (result.last) {
-            tts_stop_speech(task);
-            if (m_tts_queue.empty()) {
-                emit tts_partial_speech_playing("", task);
-            } else {
-                if (result.remove_audio_file)
-                    QFile::remove(result.audio_file_path);
-                m_tts_queue.pop();
-            }
-            emit tts_play_speech_finished(task);
-        } else {
-            if (result.remove_audio_file) QFile::remove(result.audio_file_path);
-            m_tts_queue.pop();
+    emit tts_partial_speech_playing(result.text, result.task_id);
+}
 
-            if (m_tts_queue.empty()) {
-                emit tts_partial_speech_playing("", task);
-            }
-        }
+void speech_service::handle_player_segment_finished() {
+    if (!m_current_task || m_current_task->engine != engine_t::tts ||
+        m_tts_queue.empty())
+        return;
 
-        handle_tts_queue();
+    auto result = std::move(m_tts_queue.front());
+    m_tts_queue.pop();
+
+    if (result.last) {
+        finish_tts_speech(result.task_id);
+        return;
     }
+
+    if (m_tts_queue.empty())
+        emit tts_partial_speech_playing("", result.task_id);
+
+    handle_tts_queue();
 }
 
 QVariantMap speech_service::available_models(
@@ -2105,34 +2474,110 @@ void speech_service::delete_model(const QString &id) {
 
 void speech_service::handle_audio_available() {
     if (m_source && m_stt_engine && m_stt_engine->started()) {
-        if (m_stt_engine->speech_detection_status() ==
-            stt_engine::speech_detection_status_t::initializing) {
-            if (m_source->type() == audio_source::source_type::mic)
-                m_source->clear();
-            else
-                m_source->slowdown();
+        auto initializing =
+            m_stt_engine->speech_detection_status() ==
+            stt_engine::speech_detection_status_t::initializing;
+
+        if (m_source->type() == audio_source::source_type::mic &&
+            (initializing || !m_preroll.empty())) {
+            // mic audio is kept until engine is ready, live audio goes
+            // through pre-roll as long as it is not drained to keep order
+            fill_preroll();
+            if (!initializing) drain_preroll();
             return;
         }
 
-        auto [buf, max_size] = m_stt_engine->borrow_buf();
+        // source is pulled again when engine is ready
+        if (initializing) return;
+
+        // file must be decoded with the new model only
+        if (m_stt_engine_next &&
+            m_source->type() != audio_source::source_type::mic)
+            return;
+
+        // decoded audio is written to engine directly from source's thread
+        if (m_source->attach_sink(m_stt_engine.get())) {
+            update_file_progress();
+            return;
+        }
+
+        // source is drained as long as engine has space, when in-buf is full
+        // engine reports free space with in_buf_space_available callback
+        while (true) {
+            auto [buf, max_size] = m_stt_engine->borrow_buf();
+            if (!buf) break;
 
-        if (buf) {
             auto audio_data = m_source->read_audio(buf, max_size);
 
             m_stt_engine->return_buf(buf, audio_data.size, audio_data.sof,
                                      audio_data.eof);
-            set_progress(m_source->progress());
 
-            if (audio_data.eof)
-                m_source->slowdown();
-            else
-                m_source->speedup();
-        } else {
-            m_source->slowdown();
+            if (audio_data.eof || audio_data.size < max_size) break;
         }
+
+        update_file_progress();
+    }
+}
+
+void speech_service::fill_preroll() {
+    while (!m_preroll_eof) {
+        auto [buf, size] = m_preroll.write_region();
+
+        if (size == 0) {
+            // oldest audio is dropped, even size keeps samples aligned
+            m_preroll.commit_read(
+                std::min(m_preroll.size(), m_preroll.capacity() / 8) &
+                ~size_t{1});
+            continue;
+        }
+
+        auto audio_data = m_source->read_audio(buf, size);
+
+        m_preroll.commit_write(audio_data.size);
+        if (audio_data.sof) m_preroll_sof = true;
+        if (audio_data.eof) m_preroll_eof = true;
+
+        if (audio_data.size < size) break;
     }
 }
 
+void speech_service::drain_preroll() {
+    // only whole samples are written, odd byte stays in pre-roll until rest
+    // of the sample is read from source
+    while (m_preroll.size() >= 2 || m_preroll_eof) {
+        auto [buf, max_size] = m_stt_engine->borrow_buf();
+        if (!buf) break;
+
+        // read copies across ring wrap, so sample split there is not stuck
+        auto n = m_preroll.read(
+            buf, std::min(m_preroll.size(), max_size) & ~size_t{1});
+
+        auto eof = m_preroll_eof && m_preroll.size() < 2;
+        if (eof) {
+            // incomplete sample at the end of stream is dropped
+            m_preroll_eof = false;
+            m_preroll.clear();
+        }
+
+        m_stt_engine->return_buf(buf, n, std::exchange(m_preroll_sof, false),
+                                 eof);
+
+        if (eof || n == 0) break;
+    }
+
+    if (m_preroll.empty() && !m_preroll_eof) {
+        qDebug() << "pre-roll drained";
+        reset_preroll();
+    }
+}
+
+void speech_service::reset_preroll() {
+    m_preroll.clear();
+    m_preroll.reset_high_water_mark();
+    m_preroll_sof = false;
+    m_preroll_eof = false;
+}
+
 void speech_service::set_progress(double p) {
     if (audio_source_type() == source_t::file && m_current_task) {
         const auto delta = p - m_progress;
@@ -2144,6 +2589,25 @@ void speech_service::set_progress(double p) {
     }
 }
 
+void speech_service::update_file_progress() {
+    if (!m_source || !m_stt_engine) return;
+
+    // source progress only says how much of the file was read, part of it
+    // can still be waiting in the engine for decoding
+    auto p = m_source->progress() * m_stt_engine->processed_fraction();
+
+    if (p > m_progress) set_progress(p);
+}
+
+QVariantMap speech_service::stt_result_cache_stats() const {
+    const auto &stats = m_stt_result_cache.stats();
+
+    return {{QStringLiteral("hits"), static_cast<qulonglong>(stats.hits)},
+            {QStringLiteral("misses"), static_cast<qulonglong>(stats.misses)},
+            {QStringLiteral("entries"), static_cast<qulonglong>(stats.entries)},
+            {QStringLiteral("size"), static_cast<qulonglong>(stats.size)}};
+}
+
 double speech_service::stt_transcribe_file_progress(int task) const {
     if (audio_source_type() == source_t::file) {
         if (m_current_task && m_current_task->id == task) {
@@ -2356,6 +2820,66 @@ int speech_service::stt_transcribe_file(const QString &file, QString lang,
     if (lang.contains('-')) lang = lang.split('-').first();
     if (out_lang.contains('-')) out_lang = out_lang.split('-').first();
 
+    auto file_path = QFileInfo::exists(file) ? file : QUrl{file}.toLocalFile();
+
+    QString cache_key;
+    QString engine_params;
+    if (auto model_config = choose_model_config(engine_t::stt, lang);
+        model_config && model_config->stt) {
+        engine_params = make_stt_engine_params(*model_config, out_lang);
+        cache_key = stt_result_cache::make_key(file_path, engine_params);
+
+        if (auto texts = m_stt_result_cache.get(cache_key)) {
+            if (m_current_task &&
+                m_current_task->speech_mode !=
+                    speech_mode_t::single_sentence &&
+                audio_source_type() == source_t::mic) {
+                m_pending_task = m_current_task;
+            }
+
+            // mic audio must not be decoded as a part of cached task,
+            // listening is restored when the task is finished
+            if (m_stt_engine) {
+                if (m_source) m_source->attach_sink(nullptr);
+                m_stt_engine->stop();
+            }
+            restart_audio_source();
+
+            m_current_task = {next_task_id(),
+                              engine_t::stt,
+                              model_config->stt->model_id,
+                              speech_mode_t::automatic,
+                              out_lang,
+                              {},
+                              {},
+                              {},
+                              false};
+
+            qDebug() << "transcription found in cache:" << m_current_task->id;
+
+            start_keepalive_current_task();
+
+            emit current_task_changed();
+
+            refresh_status();
+
+            // result is sent after task id is returned
+            QTimer::singleShot(
+                0, this,
+                [this, task_id = m_current_task->id,
+                 texts = std::move(*texts),
+                 model_id = m_current_task->model_id] {
+                    if (current_task_id() != task_id) return;
+                    for (const auto &text : texts)
+                        emit stt_text_decoded(text, model_id, task_id);
+                    emit stt_file_transcribe_finished(task_id);
+                    cancel(task_id);
+                });
+
+            return m_current_task->id;
+        }
+    }
+
     if (m_current_task &&
         m_current_task->speech_mode != speech_mode_t::single_sentence &&
         audio_source_type() == source_t::mic) {
@@ -2385,12 +2909,22 @@ int speech_service::stt_transcribe_file(const QString &file, QString lang,
         return INVALID_TASK;
     }
 
+    // interrupted transcription of the same file with the same engine params
+    // is continued from the last checkpoint
+    save_checkpoint();
+    m_checkpoint.emplace(
+        QDir{settings::instance()->cache_dir()}.filePath(
+            QStringLiteral("checkpoints")),
+        file_path,
+        engine_params.isEmpty() ? m_current_task->model_id : engine_params);
+    m_checkpoint_task = m_current_task->id;
+    m_stt_result_cache_key = cache_key;
+
     try {
-        if (QFileInfo::exists(file))
-            restart_audio_source(file);
-        else
-            restart_audio_source(QUrl{file}.toLocalFile());
+        restart_audio_source(file_path, m_checkpoint->offset_ms());
     } catch (const std::runtime_error &err) {
+        m_checkpoint.reset();
+        m_checkpoint_task = INVALID_TASK;
         m_current_task.reset();
 
         qCritical() << "audio source error:" << err.what();
@@ -2411,6 +2945,21 @@ int speech_service::stt_transcribe_file(const QString &file, QString lang,
 
     refresh_status();
 
+    if (!m_checkpoint->texts().isEmpty()) {
+        qDebug() << "resuming transcription from:" << m_checkpoint->offset_ms()
+                 << "ms";
+
+        // text decoded before checkpoint is sent after task id is returned
+        QTimer::singleShot(0, this,
+                           [this, task_id = m_current_task->id,
+                            texts = m_checkpoint->texts()] {
+                               if (current_task_id() != task_id) return;
+                               for (const auto &text : texts)
+                                   emit stt_text_decoded(
+                                       text, m_current_task->model_id, task_id);
+                           });
+    }
+
     return m_current_task->id;
 }
 
@@ -2684,9 +3233,12 @@ int speech_service::cancel(int task) {
         qWarning() << "invalid task id";
     }
 
+    // cancelled or timed out transcription can be continued later
+    save_checkpoint();
+
     stop_keepalive_current_task();
 
-    m_player.pause();
+    m_player.stop();
 
     if (m_pending_task) {
         qDebug() << "retriving pending task:" << m_pending_task->id;
@@ -2721,8 +3273,6 @@ int speech_service::cancel(int task) {
 
     clean_tts_queue();
 
-    m_player.stop();
-
     refresh_status();
 
     return SUCCESS;
@@ -2793,7 +3343,7 @@ int speech_service::tts_pause_speech(int task) {
 
     m_current_task->paused = true;
 
-    if (m_player.state() == QMediaPlayer::PlayingState) m_player.pause();
+    m_player.pause();
 
     update_task_state();
 
@@ -2826,7 +3376,7 @@ int speech_service::tts_resume_speech(int task) {
 
     m_current_task->paused = false;
 
-    if (m_player.state() == QMediaPlayer::PausedState) m_player.play();
+    m_player.resume();
 
     handle_tts_queue();
 
@@ -2836,11 +3386,7 @@ int speech_service::tts_resume_speech(int task) {
 }
 
 void speech_service::clean_tts_queue() {
-    while (!m_tts_queue.empty()) {
-        if (m_tts_queue.front().remove_audio_file)
-            QFile::remove(m_tts_queue.front().audio_file_path);
-        m_tts_queue.pop();
-    }
+    while (!m_tts_queue.empty()) m_tts_queue.pop();
 }
 
 int speech_service::tts_stop_speech(int task) {
@@ -2862,13 +3408,11 @@ int speech_service::tts_stop_speech(int task) {
 
     stop_keepalive_current_task();
 
-    m_player.pause();
+    m_player.stop();
     stop_tts_engine();
 
     clean_tts_queue();
 
-    m_player.stop();
-
     return SUCCESS;
 }
 
@@ -2902,7 +3446,13 @@ void speech_service::stop_tts_engine() {
 void speech_service::stop_stt_engine() {
     qDebug() << "stop stt engine";
 
-    if (m_stt_engine) m_stt_engine->stop();
+    if (m_stt_engine) {
+        if (m_source) m_source->attach_sink(nullptr);
+        m_stt_engine->stop();
+    }
+
+    // audio queued before engine swap is not needed anymore
+    return_stt_engine_to_pool(m_stt_engine_draining);
 
     restart_audio_source();
 
@@ -2958,16 +3508,25 @@ void speech_service::handle_audio_ended() {
     }
 }
 
-void speech_service::restart_audio_source(const QString &source_file) {
+void speech_service::restart_audio_source(const QString &source_file,
+                                          uint64_t start_time_ms) {
     if (m_stt_engine && m_stt_engine->started()) {
         qDebug() << "creating audio source";
 
         if (m_source) m_source->disconnect();
 
+        reset_preroll();
+
+        m_stt_engine->set_offline_mode(!source_file.isEmpty());
+
         if (source_file.isEmpty())
             m_source = std::make_unique<mic_source>();
         else
-            m_source = std::make_unique<file_source>(source_file);
+            m_source = std::make_unique<file_source>(
+                source_file,
+                media_resampler_from_resampler_quality(
+                    settings::instance()->resampler_quality()),
+                start_time_ms);
 
         set_progress(m_source->progress());
         connect(m_source.get(), &audio_source::audio_available, this,
@@ -3024,12 +3583,11 @@ void speech_service::update_task_state() {
                 case stt_engine::speech_detection_status_t::no_speech:
                     break;
             }
-        } else if (m_player.state() == QMediaPlayer::State::PlayingState &&
+        } else if (m_player.state() == tts_player::state_t::playing &&
                    m_state == state_t::playing_speech) {
             return 4;
-        } else if (m_player.state() == QMediaPlayer::State::PausedState ||
-                   (m_player.state() == QMediaPlayer::State::StoppedState &&
-                    m_state == state_t::playing_speech && m_current_task &&
+        } else if (m_player.state() == tts_player::state_t::paused ||
+                   (m_state == state_t::playing_speech && m_current_task &&
                     m_current_task->paused)) {
             return 5;
         } else if (m_tts_engine &&
@@ -3559,6 +4117,11 @@ QVariantMap speech_service::MntGetOutLangs(const QString &lang) {
     return mnt_out_langs(lang);
 }
 
+QVariantMap speech_service::SttResultCacheStats() {
+    qDebug() << "[dbus => service] called SttResultCacheStats";
+    return stt_result_cache_stats();
+}
+
 QVariantMap speech_service::FeaturesAvailability() {
     qDebug() << "[dbus => "
                 "service] "
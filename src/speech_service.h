@@ -10,11 +10,11 @@
 
 #include <QDebug>
 #include <QIODevice>
-#include <QMediaPlayer>
 #include <QObject>
 #include <QString>
 #include <QTimer>
 #include <QVariantList>
+#include <list>
 #include <map>
 #include <memory>
 #include <optional>
@@ -29,9 +29,13 @@
 #include "dbus_speech_adaptor.h"
 #include "mnt_engine.hpp"
 #include "models_manager.h"
+#include "ring_buffer.hpp"
 #include "singleton.h"
 #include "stt_engine.hpp"
+#include "stt_result_cache.hpp"
+#include "transcribe_checkpoint.hpp"
 #include "tts_engine.hpp"
+#include "tts_player.h"
 
 QDebug operator<<(QDebug d, const stt_engine::config_t &config);
 QDebug operator<<(QDebug d, const tts_engine::config_t &config);
@@ -110,7 +114,6 @@ class speech_service : public QObject, public singleton<speech_service> {
         QString audio_file_path;
         tts_engine::audio_format_t audio_format =
             tts_engine::audio_format_t::wav;
-        bool remove_audio_file = false;
         bool last = false;
         int task_id = INVALID_TASK;
     };
@@ -168,6 +171,7 @@ class speech_service : public QObject, public singleton<speech_service> {
     state_t state() const;
     int current_task_id() const;
     double stt_transcribe_file_progress(int task) const;
+    QVariantMap stt_result_cache_stats() const;
     double tts_speech_to_file_progress(int task) const;
     QVariantMap mnt_out_langs(QString in_lang) const;
     QVariantMap features_availability();
@@ -197,11 +201,15 @@ class speech_service : public QObject, public singleton<speech_service> {
     void mnt_engine_state_changed(mnt_engine::state_t state, int task_id);
     void current_task_changed();
     void sentence_timeout(int task_id);
-    void stt_engine_eof(int task_id);
-    void stt_engine_error(int task_id);
+    void stt_engine_eof(int task_id, qulonglong engine_id);
+    void stt_engine_error(int task_id, qulonglong engine_id);
     void tts_engine_error(int task_id);
     void mnt_engine_error(int task_id);
     void stt_engine_shutdown();
+    void stt_engine_ready();
+    void stt_engine_in_buf_space_available();
+    void stt_engine_text_decoded(const QString &text, qulonglong decoded_ms,
+                                 int task_id);
     void default_stt_model_changed();
     void default_stt_lang_changed();
     void default_tts_model_changed();
@@ -344,12 +352,36 @@ class speech_service : public QObject, public singleton<speech_service> {
     static const int KEEPALIVE_TIME = 60000;           // 60s
     static const int KEEPALIVE_TASK_TIME = 10000;      // 10s
     static const int SINGLE_SENTENCE_TIMEOUT = 10000;  // 10s
+    static const size_t PREROLL_SIZE = 16000 * 2 * 30;  // 30s of s16 mono
+
+    // stopped stt engine with loaded model kept for quick reuse
+    struct pooled_stt_engine_t {
+        std::unique_ptr<stt_engine> engine;
+        size_t mem_size = 0;
+    };
 
     int m_last_task_id = INVALID_TASK;
     std::unique_ptr<stt_engine> m_stt_engine;
+    // engine loading model in background, replaces m_stt_engine when ready
+    std::unique_ptr<stt_engine> m_stt_engine_next;
+    // replaced engine decoding audio queued before swap
+    std::unique_ptr<stt_engine> m_stt_engine_draining;
+    uint64_t m_last_stt_engine_id = 0;
+    std::list<pooled_stt_engine_t>
+        m_stt_engine_pool;  // most recently used first
+    // mic audio captured while stt engine is initializing
+    ring_buffer<char> m_preroll{PREROLL_SIZE};
+    bool m_preroll_sof = false;
+    bool m_preroll_eof = false;
     std::unique_ptr<tts_engine> m_tts_engine;
     std::unique_ptr<mnt_engine> m_mnt_engine;
     std::unique_ptr<audio_source> m_source;
+    // progress of current file transcription
+    std::optional<transcribe_checkpoint> m_checkpoint;
+    int m_checkpoint_task = INVALID_TASK;
+    // texts of finished file transcriptions
+    stt_result_cache m_stt_result_cache;
+    QString m_stt_result_cache_key;
     std::map<QString, model_data_t>
         m_available_stt_models_map;  // model-id => model data
     std::map<QString, model_data_t>
@@ -370,7 +402,7 @@ class speech_service : public QObject, public singleton<speech_service> {
     std::optional<task_t> m_previous_task;
     std::optional<task_t> m_current_task;
     std::optional<task_t> m_pending_task;
-    QMediaPlayer m_player;
+    tts_player m_player;
     int m_task_state = 0;
     std::queue<tts_partial_result_t> m_tts_queue;
     QVariantMap m_features_availability;
@@ -383,10 +415,10 @@ class speech_service : public QObject, public singleton<speech_service> {
     void handle_tts_models_changed();
     void handle_stt_sentence_timeout();
     void handle_stt_sentence_timeout(int task_id);
-    void handle_stt_engine_eof();
-    void handle_stt_engine_eof(int task_id);
-    void handle_stt_engine_error();
-    void handle_stt_engine_error(int task_id);
+    void handle_stt_engine_eof(qulonglong engine_id);
+    void handle_stt_engine_eof(int task_id, qulonglong engine_id);
+    void handle_stt_engine_error(qulonglong engine_id);
+    void handle_stt_engine_error(int task_id, qulonglong engine_id);
     void handle_tts_engine_error();
     void handle_tts_engine_error(int task_id);
     void handle_mnt_engine_error();
@@ -398,7 +430,11 @@ class speech_service : public QObject, public singleton<speech_service> {
                                        const std::string &in_lang,
                                        std::string &&out_text,
                                        const std::string &out_lang);
-    void handle_stt_text_decoded(const std::string &text);
+    void handle_stt_text_decoded(const std::string &text,
+                                 size_t samples_decoded);
+    void handle_stt_engine_text_decoded(const QString &text,
+                                        qulonglong decoded_ms, int task_id);
+    void save_checkpoint();
     void handle_stt_text_decoded(const QString &text, const QString &model_id,
                                  int task_id);
     void handle_stt_intermediate_text_decoded(const std::string &text);
@@ -408,13 +444,25 @@ class speech_service : public QObject, public singleton<speech_service> {
                                    bool last);
     void handle_tts_speech_encoded(tts_partial_result_t result);
     void handle_speech_to_file(const tts_partial_result_t &result);
-    void handle_player_state_changed(QMediaPlayer::State new_state);
+    void handle_player_state_changed();
+    void handle_player_segment_started();
+    void handle_player_segment_finished();
     void handle_audio_available();
+    void fill_preroll();
+    void drain_preroll();
+    void reset_preroll();
     void handle_stt_speech_detection_status_changed(
         stt_engine::speech_detection_status_t status);
     void handle_processing_changed(bool processing);
     void handle_audio_error();
     void handle_audio_ended();
+    stt_engine::config_t make_stt_engine_config(
+        const model_config_t &model_config, speech_mode_t speech_mode,
+        const QString &out_lang_id);
+    // everything that has impact on decoded text, used to identify cached
+    // results and checkpoints
+    QString make_stt_engine_params(const model_config_t &model_config,
+                                   const QString &out_lang_id);
     QString restart_stt_engine(speech_mode_t speech_mode,
                                const QString &model_id,
                                const QString &out_lang_id);
@@ -423,10 +471,12 @@ class speech_service : public QObject, public singleton<speech_service> {
     QString restart_mnt_engine(const QString &model_or_lang_id,
                                const QString &out_lang_id,
                                const QVariantMap &options);
-    void restart_audio_source(const QString &source_file = {});
+    void restart_audio_source(const QString &source_file = {},
+                              uint64_t start_time_ms = 0);
     void stop_stt();
     source_t audio_source_type() const;
     void set_progress(double progress);
+    void update_file_progress();
     std::optional<speech_service::model_config_t> choose_model_config_by_id(
         const std::vector<models_manager::model_t> &models,
         engine_t engine_type, const QString &model_or_lang_id,
@@ -443,6 +493,17 @@ class speech_service : public QObject, public singleton<speech_service> {
     inline auto recording() const { return static_cast<bool>(m_source); }
     void refresh_status();
     void stop_stt_engine_gracefully();
+    std::unique_ptr<stt_engine> make_stt_engine(
+        models_manager::model_engine_t engine_type,
+        stt_engine::config_t config);
+    void handle_stt_engine_ready();
+    void return_stt_engine_to_pool(std::unique_ptr<stt_engine> &engine);
+    void drain_stt_engine(std::unique_ptr<stt_engine> &engine);
+    static uint64_t stt_engine_id(const std::unique_ptr<stt_engine> &engine);
+    std::unique_ptr<stt_engine> take_stt_engine_from_pool(
+        models_manager::model_engine_t engine_type,
+        const stt_engine::config_t &config);
+    void shrink_stt_engine_pool();
     void stop_stt_engine();
     void stop_tts_engine();
     void stop_mnt_engine();
@@ -478,6 +539,7 @@ class speech_service : public QObject, public singleton<speech_service> {
     void set_state(state_t new_state);
     void update_task_state();
     void handle_tts_queue();
+    void finish_tts_speech(int task);
     static std::vector<std::reference_wrapper<const model_data_t>>
     model_data_for_lang(
         const QString &lang_id,
@@ -519,6 +581,7 @@ class speech_service : public QObject, public singleton<speech_service> {
                                   const QVariantMap &options);
     Q_INVOKABLE QVariantMap MntGetOutLangs(const QString &lang);
     Q_INVOKABLE QVariantMap FeaturesAvailability();
+    Q_INVOKABLE QVariantMap SttResultCacheStats();
 };
 
 Q_DECLARE_METATYPE(speech_service::tts_partial_result_t)
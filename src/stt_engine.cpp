@@ -14,6 +14,7 @@
 #include <iterator>
 #include <numeric>
 #include <sstream>
+#include <tuple>
 
 #include "logger.hpp"
 
@@ -55,22 +56,6 @@ std::ostream& operator<<(std::ostream& os,
     return os;
 }
 
-std::ostream& operator<<(std::ostream& os, stt_engine::lock_type_t lock_type) {
-    switch (lock_type) {
-        case stt_engine::lock_type_t::borrowed:
-            os << "borrowed";
-            break;
-        case stt_engine::lock_type_t::free:
-            os << "free";
-            break;
-        case stt_engine::lock_type_t::processed:
-            os << "processed";
-            break;
-    }
-
-    return os;
-}
-
 std::ostream& operator<<(std::ostream& os, stt_engine::flush_t flush_type) {
     switch (flush_type) {
         case stt_engine::flush_t::regular:
@@ -140,6 +125,19 @@ std::ostream& operator<<(std::ostream& os, stt_engine::vad_mode_t mode) {
     return os;
 }
 
+std::ostream& operator<<(std::ostream& os, stt_engine::vad_backend_t backend) {
+    switch (backend) {
+        case stt_engine::vad_backend_t::webrtc:
+            os << "webrtc";
+            break;
+        case stt_engine::vad_backend_t::silero:
+            os << "silero";
+            break;
+    }
+
+    return os;
+}
+
 std::ostream& operator<<(std::ostream& os, stt_engine::gpu_api_t api) {
     switch (api) {
         case stt_engine::gpu_api_t::opencl:
@@ -179,15 +177,54 @@ std::ostream& operator<<(std::ostream& os, const stt_engine::config_t& config) {
        << ", model-files=[" << config.model_files
        << "], speech-mode=" << config.speech_mode
        << ", vad-mode=" << config.vad_mode
+       << ", vad-backend=" << config.vad_backend
+       << ", vad-model-file=" << config.vad_model_file
+       << ", vad-onset=" << config.vad_onset_ms
+       << ", vad-hangover=" << config.vad_hangover_ms
        << ", speech-started=" << config.speech_started
+       << ", translate=" << config.translate
+       << ", adaptive-audio-ctx=" << config.adaptive_audio_ctx
+       << ", streaming=" << config.streaming
+       << ", streaming-interval=" << config.streaming_interval_ms
+       << ", partial-interval=" << config.partial_interval_ms
        << ", options=" << config.options << ", use-gpu=" << config.use_gpu
        << ", gpu-device=[" << config.gpu_device << "]";
 
     return os;
 }
 
+std::ostream& operator<<(std::ostream& os,
+                         const stt_engine::in_buf_stats_t& stats) {
+    os << "depth=" << stats.depth << ", capacity=" << stats.capacity
+       << ", high-water-mark=" << stats.high_water_mark
+       << ", overflows=" << stats.overflows;
+
+    return os;
+}
+
+static vad::config_t make_vad_config(const stt_engine::config_t& config) {
+    vad::config_t vad_config;
+
+    vad_config.webrtc_mode = static_cast<int>(config.vad_mode);
+
+    if (config.vad_backend == stt_engine::vad_backend_t::silero) {
+        vad_config.backend = vad::backend_t::silero;
+        vad_config.silero_model_file = config.vad_model_file;
+        // -40 dBFS, skips neural network on obvious silence
+        vad_config.energy_gate_peak = 328;
+    }
+
+    vad_config.onset_ms = config.vad_onset_ms;
+    vad_config.hangover_ms = config.vad_hangover_ms;
+
+    return vad_config;
+}
+
 stt_engine::stt_engine(config_t config, callbacks_t call_backs)
-    : m_config{std::move(config)}, m_call_backs{std::move(call_backs)} {}
+    : m_config{std::move(config)},
+      m_call_backs{std::move(call_backs)},
+      m_speech_mode{m_config.speech_mode},
+      m_vad{make_vad_config(m_config)} {}
 
 stt_engine::~stt_engine() { LOGD("engine dtor"); }
 
@@ -202,6 +239,7 @@ void stt_engine::start() {
     if (m_processing_thread.joinable()) m_processing_thread.join();
 
     m_thread_exit_requested = false;
+    m_ready = false;
 
     m_processing_thread = std::thread{&stt_engine::start_processing, this};
 
@@ -221,7 +259,10 @@ void stt_engine::stop() {
         return;
     }
 
-    m_thread_exit_requested = true;
+    {
+        std::lock_guard lock{m_processing_mtx};
+        m_thread_exit_requested = true;
+    }
 
     LOGD("stop requested");
 
@@ -233,6 +274,7 @@ void stt_engine::stop() {
     }
 
     m_processing_cv.notify_all();
+    m_preprocessing_cv.notify_all();
     if (m_processing_thread.joinable()) m_processing_thread.join();
     m_config.speech_started = false;
     set_speech_detection_status(speech_detection_status_t::no_speech);
@@ -245,17 +287,24 @@ void stt_engine::start_processing() {
     LOGD("processing started");
 
     m_thread_exit_requested = false;
+    m_preprocessing_exit_requested = false;
+
+    // denoise and vad run ahead of decoding, so samples keep being
+    // segmented while engine is initializing or decoding
+    m_preprocessing_thread =
+        std::thread{&stt_engine::start_preprocessing, this};
 
     try {
         set_processing_state(processing_state_t::initializing);
         start_processing_impl();
         set_processing_state(processing_state_t::idle);
 
+        m_ready = true;
+        if (m_call_backs.ready) m_call_backs.ready();
+
         while (true) {
             LOGT("processing iter");
 
-            std::unique_lock lock{m_processing_mtx};
-
             if (m_thread_exit_requested) break;
 
             if (m_restart_requested) {
@@ -263,9 +312,14 @@ void stt_engine::start_processing() {
                 flush(flush_t::restart);
             }
 
-            if (process_buff() == samples_process_result_t::wait_for_samples &&
-                !m_thread_exit_requested)
-                m_processing_cv.wait(lock);
+            if (process_buff() == samples_process_result_t::wait_for_samples) {
+                std::unique_lock lock{m_processing_mtx};
+                m_processing_cv.wait(lock, [this] {
+                    return m_thread_exit_requested || m_restart_requested ||
+                           std::exchange(m_processing_notified, false) ||
+                           !m_segments.empty();
+                });
+            }
         }
 
         flush(flush_t::exit);
@@ -275,23 +329,20 @@ void stt_engine::start_processing() {
         if (m_call_backs.error) m_call_backs.error();
     }
 
-    reset_in_processing();
+    {
+        std::lock_guard lock{m_processing_mtx};
+        m_preprocessing_exit_requested = true;
+    }
+    m_preprocessing_cv.notify_all();
+    if (m_preprocessing_thread.joinable()) m_preprocessing_thread.join();
 
-    LOGD("processing ended");
-}
+    m_ready = false;
 
-bool stt_engine::lock_buf(lock_type_t desired_lock) {
-    lock_type_t expected_lock = lock_type_t::free;
-    return m_in_buf.lock.compare_exchange_strong(expected_lock, desired_lock);
-}
+    reset_in_processing();
 
-void stt_engine::free_buf(lock_type_t lock) {
-    lock_type_t expected_lock = lock;
-    m_in_buf.lock.compare_exchange_strong(expected_lock, lock_type_t::free);
+    LOGD("processing ended");
 }
 
-void stt_engine::free_buf() { m_in_buf.lock.store(lock_type_t::free); }
-
 std::pair<char*, size_t> stt_engine::borrow_buf() {
     decltype(borrow_buf()) c_buf{nullptr, 0};
 
@@ -299,69 +350,261 @@ std::pair<char*, size_t> stt_engine::borrow_buf() {
         return c_buf;
     }
 
-    if (!lock_buf(lock_type_t::borrowed)) {
-        LOGT("failed to lock for borrowing");
-        return c_buf;
+    auto [ptr, size] = m_in_ring.write_region();
+
+    if (size == 0) {
+        // flag is set before second check, so reader either frees space
+        // before it or sees the flag and reports space later
+        m_in_full = true;
+        std::tie(ptr, size) = m_in_ring.write_region();
     }
 
-    if (m_in_buf.full()) {
+    if (size == 0) {
         LOGD("in-buf is full");
-        free_buf();
-        m_processing_cv.notify_one();
+        ++m_in_overflows;
+        notify_preprocessing();
         return c_buf;
     }
 
-    c_buf.first = reinterpret_cast<char*>(&m_in_buf.buf.at(m_in_buf.size));
-    c_buf.second = (m_in_buf.buf.size() - m_in_buf.size) *
-                   sizeof(in_buf_t::buf_t::value_type);
+    c_buf.first = reinterpret_cast<char*>(ptr);
+    c_buf.second = size * sizeof(in_buf_t::buf_t::value_type);
 
     return c_buf;
 }
 
 void stt_engine::return_buf(const char* c_buf, size_t size, bool sof,
                             bool eof) {
-    if (m_in_buf.lock != lock_type_t::borrowed) return;
+    if (c_buf == nullptr) return;
 
-    LOGT("lock buff returned: sof=" << sof << ", eof=" << eof
-                                    << ", buf size=" << size);
+    LOGT("buff returned: sof=" << sof << ", eof=" << eof
+                               << ", buf size=" << size);
 
-    m_in_buf.size =
-        (c_buf - reinterpret_cast<char*>(m_in_buf.buf.data()) + size) /
-        sizeof(in_buf_t::buf_t::value_type);
-    m_in_buf.eof = eof;
-    if (sof) m_in_buf.sof = sof;
+    if (sof) m_in_sof = true;
 
-    free_buf();
-    m_processing_cv.notify_one();
+    auto samples = size / sizeof(in_buf_t::buf_t::value_type);
+    m_in_ring.commit_write(samples);
+    m_in_samples_written += samples;
+
+    if (eof) m_in_eof = true;
+
+    notify_preprocessing();
+}
+
+void stt_engine::drain() {
+    LOGD("drain requested");
+
+    m_in_eof = true;
+
+    notify_preprocessing();
+}
+
+void stt_engine::notify_preprocessing() {
+    // empty critical section guarantees that the preprocessing thread is
+    // either before its predicate check or already waiting
+    { std::lock_guard lock{m_processing_mtx}; }
+    m_preprocessing_cv.notify_one();
+}
+
+stt_engine::in_buf_stats_t stt_engine::in_buf_stats() const {
+    return {m_in_ring.size(), m_in_ring.capacity(),
+            m_in_ring.high_water_mark(), m_in_overflows.load()};
+}
+
+size_t stt_engine::in_buf_ready_size() const {
+    // there is no latency requirement in offline mode, so bigger bufs are
+    // processed with less overhead
+    if (m_offline_mode) return m_in_buf_max_size;
+
+    return m_in_buf_live_size;
+}
+
+bool stt_engine::in_buf_ready() const {
+    return m_in_eof ||
+           m_in_buf.size + m_in_ring.size() >= in_buf_ready_size();
+}
+
+bool stt_engine::read_in_buf() {
+    if (m_in_sof.exchange(false)) m_in_buf.sof = true;
+
+    // eof must be loaded before reading to not miss samples committed with it
+    bool eof = m_in_eof;
+
+    auto samples = m_in_ring.read(m_in_buf.buf.data() + m_in_buf.size,
+                                  m_in_buf.buf.size() - m_in_buf.size);
+    m_in_buf.size += samples;
+    m_in_samples_read += samples;
+
+    if (samples > 0 && m_in_full.exchange(false) &&
+        m_call_backs.in_buf_space_available)
+        m_call_backs.in_buf_space_available();
+
+    if (eof && m_in_ring.empty()) {
+        m_in_eof = false;
+        m_in_buf.eof = true;
+    }
+
+    LOGT("read in-buf: sof=" << m_in_buf.sof << ", eof=" << m_in_buf.eof
+                             << ", buf size=" << m_in_buf.size
+                             << ", ring size=" << m_in_ring.size());
+
+    return m_in_buf.eof || m_in_buf.size >= in_buf_ready_size();
 }
 
-bool stt_engine::lock_buff_for_processing() {
-    if (!lock_buf(lock_type_t::processed)) {
-        LOGT("failed to lock for processing");
-        return false;
+void stt_engine::start_preprocessing() {
+    LOGD("preprocessing started");
+
+    while (true) {
+        {
+            std::unique_lock lock{m_processing_mtx};
+            m_preprocessing_cv.wait(lock, [this] {
+                return m_thread_exit_requested ||
+                       m_preprocessing_exit_requested ||
+                       (m_segments.size() < m_segments_max_size &&
+                        in_buf_ready());
+            });
+
+            if (m_thread_exit_requested || m_preprocessing_exit_requested)
+                break;
+        }
+
+        if (!read_in_buf()) continue;
+
+        auto segment = preprocess_in_buf();
+
+        LOGT("speech segment: size=" << segment.samples.size()
+                                     << ", sof=" << segment.sof
+                                     << ", eof=" << segment.eof
+                                     << ", speech-end=" << segment.speech_end);
+
+        {
+            std::lock_guard lock{m_processing_mtx};
+            m_segments.push_back(std::move(segment));
+        }
+
+        m_processing_cv.notify_one();
     }
 
-    LOGT("lock buff for processing: sof=" << m_in_buf.sof
-                                          << ", eof=" << m_in_buf.eof
-                                          << ", buf size=" << m_in_buf.size);
+    LOGD("preprocessing ended");
+}
+
+stt_engine::speech_segment_t stt_engine::preprocess_in_buf() {
+    speech_segment_t segment;
+    segment.sof = m_in_buf.sof;
+    segment.eof = m_in_buf.eof;
+    segment.end_pos = m_in_samples_read;
 
-    if (!m_in_buf.eof && m_in_buf.size < m_in_buf_max_size) {
-        free_buf();
-        return false;
+    if (segment.sof) {
+        m_vad.reset();
+        m_sof_pos = m_in_samples_read - m_in_buf.size;
     }
 
-    return true;
+#ifdef DUMP_AUDIO_TO_FILE
+    if (!m_file_audio_input)
+        m_file_audio_input = std::make_unique<std::ofstream>("audio_input.pcm");
+    m_file_audio_input->write(
+        reinterpret_cast<char*>(m_in_buf.buf.data()),
+        m_in_buf.size * sizeof(decltype(m_in_buf.buf)::value_type));
+#endif
+
+    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
+
+#ifdef DUMP_AUDIO_TO_FILE
+    if (!m_file_audio_after_denoise)
+        m_file_audio_after_denoise =
+            std::make_unique<std::ofstream>("audio_after_denoise.pcm");
+    m_file_audio_after_denoise->write(
+        reinterpret_cast<char*>(m_in_buf.buf.data()),
+        m_in_buf.size * sizeof(decltype(m_in_buf.buf)::value_type));
+#endif
+
+    m_vad.set_hangover(m_speech_mode == speech_mode_t::automatic
+                           ? std::max(m_config.vad_hangover_ms,
+                                      m_vad_automatic_hangover_ms)
+                           : m_config.vad_hangover_ms);
+
+    const auto& vad_buf =
+        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
+    segment.speech_end = m_vad.speech_ended();
+
+#ifdef DUMP_AUDIO_TO_FILE
+    if (!m_file_audio_after_vad)
+        m_file_audio_after_vad =
+            std::make_unique<std::ofstream>("audio_after_vad.pcm");
+    m_file_audio_after_vad->write(
+        reinterpret_cast<const char*>(vad_buf.data()),
+        vad_buf.size() * sizeof(decltype(m_in_buf.buf)::value_type));
+#endif
+
+    segment.samples.assign(vad_buf.cbegin(), vad_buf.cend());
+
+    m_in_buf.clear();
+
+    return segment;
+}
+
+std::optional<stt_engine::speech_segment_t> stt_engine::pop_segment() {
+    std::optional<speech_segment_t> segment;
+
+    {
+        std::lock_guard lock{m_processing_mtx};
+
+        if (m_segments.empty()) return segment;
+
+        segment.emplace(std::move(m_segments.front()));
+        m_segments.pop_front();
+    }
+
+    m_preprocessing_cv.notify_one();
+
+    m_samples_processed = segment->end_pos;
+
+    return segment;
+}
+
+void stt_engine::notify_processing() {
+    {
+        std::lock_guard lock{m_processing_mtx};
+        m_processing_notified = true;
+    }
+    m_processing_cv.notify_one();
+}
+
+size_t stt_engine::samples_processed() const { return m_samples_processed; }
+
+double stt_engine::processed_fraction() const {
+    auto written = m_in_samples_written.load();
+    if (written == 0) return 0.0;
+
+    return std::min(1.0, static_cast<double>(samples_processed()) /
+                             static_cast<double>(written));
 }
 
 void stt_engine::reset_in_processing() {
-    LOGD("reset in processing");
+    LOGD("reset in processing: in-buf stats=[" << in_buf_stats() << "]");
 
+    m_in_ring.clear();
+    m_in_ring.reset_high_water_mark();
+    m_in_eof = false;
+    m_in_full = false;
     m_in_buf.clear();
+    m_in_samples_written = 0;
+    m_in_samples_read = 0;
+    m_samples_processed = 0;
+    m_sof_pos = 0;
+    m_segments.clear();
+    m_processing_notified = false;
     m_start_time.reset();
     m_vad.reset();
     m_intermediate_text.reset();
+    m_streaming.reset();
     set_speech_detection_status(speech_detection_status_t::no_speech);
 
+#ifdef DUMP_AUDIO_TO_FILE
+    m_file_audio_input.reset();
+    m_file_audio_after_denoise.reset();
+    m_file_audio_after_vad.reset();
+#endif
+
     reset_impl();
 }
 
@@ -396,6 +639,68 @@ std::string stt_engine::merge_texts(const std::string& old_text,
     return old_text + " " + new_text;
 }
 
+std::string stt_engine::join_texts(const std::string& text1,
+                                   const std::string& text2) {
+    if (text1.empty()) return text2;
+    if (text2.empty()) return text1;
+    return text1 + " " + text2;
+}
+
+size_t stt_engine::streaming_state_t::commit(std::vector<segment_t>&& segments,
+                                             bool force) {
+    // last segment is never committed because speech may continue in it
+    size_t stable = 0;
+    while (stable + 1 < segments.size() &&
+           (force || (stable < pending_segments.size() &&
+                      segments[stable].text == pending_segments[stable].text)))
+        ++stable;
+
+    size_t trim = 0;
+    for (size_t i = 0; i < stable; ++i) {
+        committed_text = join_texts(committed_text, segments[i].text);
+        trim = segments[i].end;
+    }
+
+    pending_segments.assign(std::make_move_iterator(segments.begin() + stable),
+                            std::make_move_iterator(segments.end()));
+    for (auto& segment : pending_segments)
+        segment.end = segment.end > trim ? segment.end - trim : 0;
+
+    decoded_size = decoded_size > trim ? decoded_size - trim : 0;
+
+    return trim;
+}
+
+std::string stt_engine::streaming_state_t::text() const {
+    auto text = committed_text;
+    for (const auto& segment : pending_segments)
+        text = join_texts(text, segment.text);
+    return text;
+}
+
+std::string stt_engine::streaming_state_t::finish(std::string&& text) {
+    auto result = join_texts(committed_text, text);
+    reset();
+    return result;
+}
+
+void stt_engine::streaming_state_t::reset() {
+    committed_text.clear();
+    pending_segments.clear();
+    decoded_size = 0;
+}
+
+bool stt_engine::streaming_enabled() const {
+    return m_config.streaming && m_streaming_available;
+}
+
+bool stt_engine::streaming_decode_due(size_t speech_size) const {
+    return streaming_enabled() && !m_offline_mode &&
+           speech_size >= m_streaming.decoded_size +
+                              m_config.streaming_interval_ms * m_sample_rate /
+                                  1000;
+}
+
 void stt_engine::set_intermediate_text(const std::string& text) {
     if (m_intermediate_text != text) {
         m_intermediate_text = text;
@@ -457,7 +762,10 @@ void stt_engine::flush(flush_t type) {
         if ((type == flush_t::regular || type == flush_t::eof ||
              m_config.speech_mode != speech_mode_t::single_sentence) &&
             m_intermediate_text->size() >= m_min_text_size) {
-            m_call_backs.text_decoded(m_intermediate_text.value());
+            auto processed = samples_processed();
+            m_call_backs.text_decoded(
+                m_intermediate_text.value(),
+                processed > m_sof_pos ? processed - m_sof_pos : 0);
 
             if (m_config.speech_mode == speech_mode_t::single_sentence) {
                 set_speech_started(false);
@@ -467,6 +775,7 @@ void stt_engine::flush(flush_t type) {
     }
 
     m_intermediate_text.reset();
+    m_streaming.reset();
 
     if (type == flush_t::eof) {
         m_call_backs.eof();
@@ -478,6 +787,7 @@ void stt_engine::set_speech_mode(speech_mode_t mode) {
         LOGD("speech mode: " << m_config.speech_mode << " => " << mode);
 
         m_config.speech_mode = mode;
+        m_speech_mode = mode;
         set_speech_started(false);
     }
 }
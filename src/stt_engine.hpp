@@ -13,6 +13,7 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -21,14 +22,21 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
+#ifdef DUMP_AUDIO_TO_FILE
+#include <fstream>
+#endif
+
+#include "audio_sink.hpp"
 #include "denoiser.hpp"
 #include "punctuator.hpp"
+#include "ring_buffer.hpp"
 #include "vad.hpp"
 
 using namespace std::chrono_literals;
 
-class stt_engine {
+class stt_engine : public audio_sink {
    public:
     enum class speech_mode_t { automatic = 0, manual = 1, single_sentence = 2 };
     friend std::ostream& operator<<(std::ostream& os, speech_mode_t mode);
@@ -50,6 +58,9 @@ class stt_engine {
     };
     friend std::ostream& operator<<(std::ostream& os, vad_mode_t mode);
 
+    enum class vad_backend_t { webrtc = 0, silero = 1 };
+    friend std::ostream& operator<<(std::ostream& os, vad_backend_t backend);
+
     enum class gpu_api_t { opencl, cuda, rocm };
     friend std::ostream& operator<<(std::ostream& os, gpu_api_t api);
 
@@ -71,13 +82,19 @@ class stt_engine {
                                     const model_files_t& model_files);
 
     struct callbacks_t {
-        std::function<void(const std::string& text)> text_decoded;
+        // samples_decoded is number of input samples since sof that are
+        // covered by text
+        std::function<void(const std::string& text, size_t samples_decoded)>
+            text_decoded;
         std::function<void(const std::string& text)> intermediate_text_decoded;
         std::function<void(speech_detection_status_t status)>
             speech_detection_status_changed;
         std::function<void()> sentence_timeout;
         std::function<void()> eof;
         std::function<void()> error;
+        std::function<void()> ready;
+        // in-buf was full and has room for more samples again
+        std::function<void()> in_buf_space_available;
     };
 
     struct gpu_device_t {
@@ -103,7 +120,15 @@ class stt_engine {
         model_files_t model_files;
         speech_mode_t speech_mode = speech_mode_t::automatic;
         vad_mode_t vad_mode = vad_mode_t::aggressiveness3;
-        bool translate = false; /*extra whisper feature*/
+        vad_backend_t vad_backend = vad_backend_t::webrtc;
+        std::string vad_model_file; /*silero vad*/
+        unsigned int vad_onset_ms = 750;
+        unsigned int vad_hangover_ms = 300; /*manual and single sentence*/
+        bool translate = false;          /*extra whisper feature*/
+        bool adaptive_audio_ctx = true;  /*extra whisper feature*/
+        bool streaming = false;          /*extra whisper feature*/
+        unsigned int streaming_interval_ms = 1000;
+        unsigned int partial_interval_ms = 300; /*extra vosk feature*/
         bool speech_started = false;
         bool use_gpu = false;
         std::string options;
@@ -114,31 +139,69 @@ class stt_engine {
     };
     friend std::ostream& operator<<(std::ostream& os, const config_t& config);
 
+    struct in_buf_stats_t {
+        size_t depth = 0;
+        size_t capacity = 0;
+        size_t high_water_mark = 0;
+        size_t overflows = 0;
+    };
+    friend std::ostream& operator<<(std::ostream& os,
+                                    const in_buf_stats_t& stats);
+
     stt_engine(config_t config, callbacks_t call_backs);
     virtual ~stt_engine();
-    std::pair<char*, size_t> borrow_buf();
-    void return_buf(const char* c_buf, size_t size, bool sof, bool eof);
+    std::pair<char*, size_t> borrow_buf() override;
+    void return_buf(const char* c_buf, size_t size, bool sof,
+                    bool eof) override;
+    in_buf_stats_t in_buf_stats() const;
     void start();
     void stop();
     bool started() const;
+    // model is loaded and engine is processing samples
+    inline auto ready() const { return m_ready.load(); }
     inline void restart() { m_restart_requested = true; }
+    // set by owner to tell engines apart in callbacks
+    inline void set_id(uint64_t id) { m_id = id; }
+    inline auto id() const { return m_id; }
+    // queued samples are decoded and eof is reported, no new samples are
+    // expected
+    void drain();
     speech_detection_status_t speech_detection_status() const;
     void set_speech_mode(speech_mode_t mode);
-    inline auto speech_mode() const { return m_config.speech_mode; }
+    inline auto speech_mode() const { return m_speech_mode.load(); }
     void set_speech_started(bool value);
     inline auto speech_status() const { return m_config.speech_started; }
+    // offline mode is used for file transcription where latency doesn't
+    // matter, engine can decode many speech segments at once
+    inline void set_offline_mode(bool value) { m_offline_mode = value; }
+    inline auto offline_mode() const { return m_offline_mode.load(); }
+    // fraction of received samples that have been fully decoded
+    double processed_fraction() const;
     inline const model_files_t& model_files() const {
         return m_config.model_files;
     }
     inline const std::string& lang() const { return m_config.lang; }
     inline auto translate() const { return m_config.translate; }
+    inline auto adaptive_audio_ctx() const {
+        return m_config.adaptive_audio_ctx;
+    }
+    inline auto streaming() const {
+        return std::make_pair(m_config.streaming,
+                              m_config.streaming_interval_ms);
+    }
+    inline auto partial_interval() const {
+        return m_config.partial_interval_ms;
+    }
+    inline auto vad_backend() const {
+        return std::make_pair(m_config.vad_backend, m_config.vad_model_file);
+    }
+    inline auto vad_timing() const {
+        return std::make_pair(m_config.vad_onset_ms, m_config.vad_hangover_ms);
+    }
     inline auto use_gpu() const { return m_config.use_gpu; }
     inline auto gpu_device() const { return m_config.gpu_device; }
 
    protected:
-    enum class lock_type_t { free, processed, borrowed };
-    friend std::ostream& operator<<(std::ostream& os, lock_type_t lock_type);
-
     enum class flush_t { regular, eof, exit, restart };
     friend std::ostream& operator<<(std::ostream& os, flush_t flush_type);
 
@@ -151,6 +214,12 @@ class stt_engine {
 
     inline static const size_t m_sample_rate = 16000;  // 1s
     inline static const size_t m_in_buf_max_size = 24000;
+    // live audio is preprocessed in smaller bufs for faster endpointing
+    inline static const size_t m_in_buf_live_size = 3200;  // 200ms
+    // automatic mode splits speech only on longer pauses
+    inline static const unsigned int m_vad_automatic_hangover_ms = 1500;
+    inline static const size_t m_in_ring_size = 1 << 18;  // ~16s
+    inline static const size_t m_segments_max_size = 8;
     inline static const size_t m_speech_max_size = m_sample_rate * 60;  // 60s
     inline static const unsigned int m_min_text_size = 4;
     inline static const auto m_timeout = 10s;
@@ -161,7 +230,6 @@ class stt_engine {
         buf_t::size_type size = 0;
         bool sof = true;
         bool eof = false;
-        std::atomic<lock_type_t> lock = lock_type_t::free;
         [[nodiscard]] inline bool full() const { return size == buf.size(); }
         inline void clear() {
             size = 0;
@@ -170,12 +238,61 @@ class stt_engine {
         }
     };
 
+    // in-buf after denoise and vad, passed from preprocessing to processing
+    struct speech_segment_t {
+        std::vector<in_buf_t::buf_t::value_type> samples;
+        size_t end_pos = 0; /*number of input samples up to segment end*/
+        bool sof = false;
+        bool eof = false;
+        bool speech_end = false; /*vad detected end of speech in segment*/
+    };
+
+    // decoded text with position of its end in speech buf
+    struct segment_t {
+        std::string text;
+        size_t end = 0;
+    };
+
+    // streaming decode re-decodes growing speech buf, segments that are
+    // decoded the same way in consecutive decodes are committed and their
+    // audio can be removed from speech buf
+    struct streaming_state_t {
+        std::string committed_text;
+        std::vector<segment_t> pending_segments;
+        size_t decoded_size = 0;
+
+        size_t commit(std::vector<segment_t>&& segments, bool force);
+        std::string text() const;
+        std::string finish(std::string&& text);
+        void reset();
+    };
+
     config_t m_config;
     callbacks_t m_call_backs;
+    uint64_t m_id = 0;
     std::thread m_processing_thread;
+    std::thread m_preprocessing_thread;
     std::mutex m_processing_mtx;
     std::condition_variable m_processing_cv;
+    std::condition_variable m_preprocessing_cv;
     bool m_thread_exit_requested = false;
+    bool m_preprocessing_exit_requested = false;
+    bool m_processing_notified = false;
+    std::deque<speech_segment_t> m_segments;
+    ring_buffer<in_buf_t::buf_t::value_type> m_in_ring{m_in_ring_size};
+    std::atomic_bool m_in_sof = false;
+    std::atomic_bool m_in_eof = false;
+    std::atomic_size_t m_in_overflows = 0;
+    std::atomic_bool m_in_full = false;
+    std::atomic_size_t m_in_samples_written = 0;
+    size_t m_in_samples_read = 0;
+    std::atomic_size_t m_samples_processed = 0;
+    // position of first input sample after sof
+    std::atomic_size_t m_sof_pos = 0;
+    std::atomic_bool m_offline_mode = false;
+    std::atomic_bool m_ready = false;
+    // copy of speech mode for preprocessing thread
+    std::atomic<speech_mode_t> m_speech_mode;
     in_buf_t m_in_buf;
     std::optional<std::string> m_intermediate_text;
     vad m_vad;
@@ -186,25 +303,44 @@ class stt_engine {
     std::optional<std::chrono::steady_clock::time_point> m_start_time;
     processing_state_t m_processing_state = processing_state_t::idle;
     std::optional<punctuator> m_punctuator;
+    streaming_state_t m_streaming;
+    // false when engine's backend can't do streaming decode, config is kept
+    // as requested so engine still matches the same config
+    bool m_streaming_available = true;
+#ifdef DUMP_AUDIO_TO_FILE
+    std::unique_ptr<std::ofstream> m_file_audio_input;
+    std::unique_ptr<std::ofstream> m_file_audio_after_denoise;
+    std::unique_ptr<std::ofstream> m_file_audio_after_vad;
+#endif
 
     static void ltrim(std::string& s);
     static void rtrim(std::string& s);
     static std::string merge_texts(const std::string& old_text,
                                    std::string&& new_text);
+    static std::string join_texts(const std::string& text1,
+                                  const std::string& text2);
+    bool streaming_enabled() const;
+    bool streaming_decode_due(size_t speech_size) const;
     virtual samples_process_result_t process_buff();
     virtual void reset_impl() = 0;
     virtual void stop_processing_impl();
     virtual void start_processing_impl();
     void flush(flush_t type);
-    bool lock_buf(lock_type_t desired_lock);
-    bool lock_buff_for_processing();
-    void free_buf(lock_type_t lock);
-    void free_buf();
+    bool read_in_buf();
+    bool in_buf_ready() const;
+    // min number of samples in in-buf to start preprocessing
+    virtual size_t in_buf_ready_size() const;
+    void notify_preprocessing();
+    speech_segment_t preprocess_in_buf();
+    std::optional<speech_segment_t> pop_segment();
+    void notify_processing();
+    virtual size_t samples_processed() const;
     void set_speech_detection_status(speech_detection_status_t status);
     void set_intermediate_text(const std::string& text);
     void set_processing_state(processing_state_t new_state);
     void reset_in_processing();
     void start_processing();
+    void start_preprocessing();
     bool sentence_timer_timed_out();
     void restart_sentence_timer();
     void create_punctuator();
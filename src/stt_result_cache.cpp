@@ -0,0 +1,166 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "stt_result_cache.hpp"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+#include <iterator>
+
+stt_result_cache::stt_result_cache(QString dir, uint64_t max_size)
+    : m_dir{std::move(dir)}, m_max_size{max_size} {
+    load_index();
+}
+
+QString stt_result_cache::make_key(const QString& file,
+                                   const QString& params) {
+    QFileInfo info{file};
+    if (!info.isFile()) return {};
+
+    auto path = info.canonicalFilePath();
+    if (path.isEmpty()) return {};
+
+    // content is not hashed because reading multi-GB file would delay start
+    // of transcription, modified file gets new size or modification time
+    QCryptographicHash hash{QCryptographicHash::Sha1};
+    hash.addData(path.toUtf8());
+    hash.addData("\n", 1);
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData("\n", 1);
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    hash.addData("\n", 1);
+    hash.addData(params.toUtf8());
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString stt_result_cache::entry_path(const QString& key) const {
+    return QDir{m_dir}.absoluteFilePath(key + QStringLiteral(".json"));
+}
+
+void stt_result_cache::load_index() {
+    QDir{}.mkpath(m_dir);
+
+    const auto files =
+        QDir{m_dir}.entryInfoList({QStringLiteral("*.json")}, QDir::Files,
+                                  QDir::Time);
+
+    for (const auto& file : files) {
+        entry_t entry{file.completeBaseName(),
+                      static_cast<uint64_t>(file.size())};
+        m_stats.size += entry.size;
+        m_lru.push_back(std::move(entry));
+        m_entries.emplace(m_lru.back().key, std::prev(m_lru.end()));
+    }
+
+    m_stats.entries = m_lru.size();
+
+    evict();
+}
+
+std::optional<QStringList> stt_result_cache::get(const QString& key) {
+    auto it = key.isEmpty() ? m_entries.end() : m_entries.find(key);
+    if (it == m_entries.end()) {
+        ++m_stats.misses;
+        return std::nullopt;
+    }
+
+    QFile file{entry_path(key)};
+    if (!file.open(QIODevice::ReadOnly)) {
+        remove_entry(it->second);
+        ++m_stats.misses;
+        return std::nullopt;
+    }
+
+    auto json = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    if (!json.isObject()) {
+        qWarning() << "invalid stt result cache entry:" << key;
+        remove_entry(it->second);
+        ++m_stats.misses;
+        return std::nullopt;
+    }
+
+    QStringList texts;
+    const auto texts_jarray =
+        json.object().value(QStringLiteral("texts")).toArray();
+    for (const auto& text : texts_jarray) texts.push_back(text.toString());
+
+    // modification time keeps lru order between runs
+    if (file.open(QIODevice::Append)) {
+        file.setFileTime(QDateTime::currentDateTime(),
+                         QFileDevice::FileModificationTime);
+        file.close();
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+
+    ++m_stats.hits;
+
+    qDebug() << "stt result cache hit:" << key;
+
+    return texts;
+}
+
+void stt_result_cache::put(const QString& key, const QStringList& texts) {
+    if (key.isEmpty()) return;
+
+    if (auto it = m_entries.find(key); it != m_entries.end())
+        remove_entry(it->second);
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("texts"), QJsonArray::fromStringList(texts));
+    auto data = QJsonDocument{obj}.toJson(QJsonDocument::Compact);
+
+    QSaveFile file{entry_path(key)};
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "failed to open stt result cache file:" << key;
+        return;
+    }
+
+    file.write(data);
+
+    if (!file.commit()) {
+        qWarning() << "failed to write stt result cache file:" << key;
+        return;
+    }
+
+    m_lru.push_front({key, static_cast<uint64_t>(data.size())});
+    m_entries.emplace(key, m_lru.begin());
+    m_stats.size += data.size();
+    m_stats.entries = m_lru.size();
+
+    qDebug() << "stt result cache put:" << key;
+
+    evict();
+}
+
+void stt_result_cache::remove_entry(std::list<entry_t>::iterator it) {
+    QFile::remove(entry_path(it->key));
+
+    m_stats.size -= std::min(m_stats.size, it->size);
+    m_entries.erase(it->key);
+    m_lru.erase(it);
+    m_stats.entries = m_lru.size();
+}
+
+void stt_result_cache::evict() {
+    while (m_stats.size > m_max_size && !m_lru.empty()) {
+        qDebug() << "stt result cache evict:" << m_lru.back().key;
+        remove_entry(std::prev(m_lru.end()));
+    }
+}
@@ -0,0 +1,63 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef STT_RESULT_CACHE_HPP
+#define STT_RESULT_CACHE_HPP
+
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+
+/*
+ * Texts of finished file transcriptions stored on disk. Entry is identified
+ * by file path, size, modification time and parameters of the engine, so
+ * the same media is not decoded again. Least recently used entries are removed when size
+ * of the cache exceeds the limit.
+ */
+class stt_result_cache {
+   public:
+    struct stats_t {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+        uint64_t size = 0;
+    };
+
+    static const uint64_t MAX_SIZE = 0x1000000;  // 16MB
+
+    explicit stt_result_cache(QString dir, uint64_t max_size = MAX_SIZE);
+    // hash of file path, size, modification time and params, params should
+    // contain everything that has impact on decoded text, empty when file
+    // doesn't exist
+    static QString make_key(const QString& file, const QString& params);
+    std::optional<QStringList> get(const QString& key);
+    void put(const QString& key, const QStringList& texts);
+    inline const auto& stats() const { return m_stats; }
+
+   private:
+    struct entry_t {
+        QString key;
+        uint64_t size = 0;
+    };
+
+    QString m_dir;
+    uint64_t m_max_size = MAX_SIZE;
+    // most recently used first
+    std::list<entry_t> m_lru;
+    std::unordered_map<QString, std::list<entry_t>::iterator> m_entries;
+    stats_t m_stats;
+
+    void load_index();
+    QString entry_path(const QString& key) const;
+    void remove_entry(std::list<entry_t>::iterator it);
+    void evict();
+};
+
+#endif  // STT_RESULT_CACHE_HPP
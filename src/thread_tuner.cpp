@@ -0,0 +1,198 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "thread_tuner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include "cpu_tools.hpp"
+#include "logger.hpp"
+
+void thread_tuner::set_cache_file(std::string path) {
+    std::lock_guard lock{m_mtx};
+
+    m_cache_file = std::move(path);
+
+    load();
+}
+
+void thread_tuner::set_max_threads(int value) {
+    std::lock_guard lock{m_mtx};
+
+    m_max_threads = std::max(0, value);
+}
+
+int thread_tuner::max_threads() const {
+    std::lock_guard lock{m_mtx};
+
+    return m_max_threads;
+}
+
+int thread_tuner::available_threads() const {
+    auto cores =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    auto max = max_threads();
+
+    return max > 0 ? std::min(cores, max) : cores;
+}
+
+std::string thread_tuner::model_id(const std::string& model_path) {
+    auto path = model_path;
+    while (path.size() > 1 && path.back() == '/') path.pop_back();
+
+    if (auto pos = path.find_last_of('/'); pos != std::string::npos)
+        return path.substr(pos + 1);
+
+    return path;
+}
+
+std::string thread_tuner::make_key(const std::string& model_path) {
+    std::ostringstream os;
+
+    os << cpu_tools::arch() << '-' << std::thread::hardware_concurrency()
+       << '-' << model_id(model_path);
+
+    return os.str();
+}
+
+std::vector<int> thread_tuner::candidates(int max_threads) {
+    std::vector<int> list;
+
+    if (max_threads <= 4) {
+        for (int i = 1; i <= max_threads; ++i) list.push_back(i);
+    } else {
+        for (int i = 2; i < max_threads; i *= 2) list.push_back(i);
+        list.push_back(max_threads);
+    }
+
+    return list;
+}
+
+std::optional<int> thread_tuner::cached_threads(
+    const std::string& model_path) const {
+    std::lock_guard lock{m_mtx};
+
+    if (auto it = m_cache.find(make_key(model_path)); it != m_cache.end())
+        return it->second;
+
+    return std::nullopt;
+}
+
+int thread_tuner::threads(const std::string& model_path, int default_threads,
+                          const bench_t& bench) {
+    return threads(
+        model_path, default_threads, [](int) { return true; }, bench);
+}
+
+int thread_tuner::threads(const std::string& model_path, int default_threads,
+                          const prepare_t& prepare, const bench_t& bench) {
+    auto max = available_threads();
+
+    if (auto threads = cached_threads(model_path)) {
+        LOGD("tuned threads: " << *threads << " (" << model_id(model_path)
+                               << ")");
+        return std::min(*threads, max);
+    }
+
+    auto list = candidates(max);
+
+    LOGD("thread calibration started: model=" << model_id(model_path)
+                                              << ", max threads=" << max);
+
+    // first run warms up caches and allocators
+    if (!prepare(list.front()) || !bench(list.front())) {
+        LOGW("thread calibration failed");
+        return std::clamp(default_threads, 1, max);
+    }
+
+    int best = 0;
+    auto best_dur = std::numeric_limits<long long>::max();
+    int worse_count = 0;
+
+    for (auto threads : list) {
+        if (!prepare(threads)) {
+            LOGW("thread calibration failed");
+            return std::clamp(default_threads, 1, max);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (!bench(threads)) {
+            LOGW("thread calibration failed");
+            return std::clamp(default_threads, 1, max);
+        }
+
+        auto dur = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+        LOGD("thread calibration: threads=" << threads
+                                            << ", duration=" << dur << "us");
+
+        // more threads must be noticeably faster to win
+        if (best == 0 || dur < best_dur - best_dur / 20) {
+            best = threads;
+            best_dur = dur;
+            worse_count = 0;
+        } else if (++worse_count >= 2) {
+            break;
+        }
+    }
+
+    LOGD("thread calibration done: threads=" << best);
+
+    {
+        std::lock_guard lock{m_mtx};
+
+        m_cache[make_key(model_path)] = best;
+
+        save();
+    }
+
+    return best;
+}
+
+void thread_tuner::load() {
+    m_cache.clear();
+
+    if (m_cache_file.empty()) return;
+
+    std::ifstream file{m_cache_file};
+
+    std::string line;
+    while (std::getline(file, line)) {
+        auto pos = line.find('=');
+        if (pos == std::string::npos) continue;
+
+        try {
+            auto threads = std::stoi(line.substr(pos + 1));
+            if (threads > 0) m_cache[line.substr(0, pos)] = threads;
+        } catch (const std::exception&) {
+            LOGW("invalid thread tuning entry: " << line);
+        }
+    }
+
+    LOGD("thread tuning entries loaded: " << m_cache.size());
+}
+
+void thread_tuner::save() const {
+    if (m_cache_file.empty()) return;
+
+    std::ofstream file{m_cache_file, std::ios::trunc};
+    if (!file) {
+        LOGE("failed to save thread tuning: " << m_cache_file);
+        return;
+    }
+
+    for (const auto& [key, threads] : m_cache) file << key << '=' << threads << '\n';
+}
@@ -0,0 +1,60 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef THREAD_TUNER_H
+#define THREAD_TUNER_H
+
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "singleton.h"
+
+/*
+ * Finds the fastest number of decoder threads with a short synthetic run at
+ * several thread counts. The result is stored in a file and keyed by cpu arch,
+ * number of cores and model, so calibration runs once per model and host.
+ */
+class thread_tuner : public singleton<thread_tuner> {
+   public:
+    // runs synthetic work with given number of threads, returns false on error
+    using bench_t = std::function<bool(int threads)>;
+    // makes resources needed by bench, returns false on error
+    using prepare_t = std::function<bool(int threads)>;
+
+    void set_cache_file(std::string path);
+    // limit of threads set by the user, 0 means no limit
+    void set_max_threads(int value);
+    int max_threads() const;
+    // cached value or result of calibration done with bench function
+    int threads(const std::string& model_path, int default_threads,
+                const bench_t& bench);
+    // prepare is called before every bench run and it is not measured, so
+    // model that must be created for given number of threads can be loaded
+    // there
+    int threads(const std::string& model_path, int default_threads,
+                const prepare_t& prepare, const bench_t& bench);
+    std::optional<int> cached_threads(const std::string& model_path) const;
+    static std::vector<int> candidates(int max_threads);
+    static std::string model_id(const std::string& model_path);
+
+   private:
+    mutable std::mutex m_mtx;
+    std::string m_cache_file;
+    std::unordered_map<std::string, int> m_cache;
+    int m_max_threads = 0;
+
+    static std::string make_key(const std::string& model_path);
+    int available_threads() const;
+    void load();
+    void save() const;
+};
+
+#endif  // THREAD_TUNER_H
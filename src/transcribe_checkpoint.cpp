@@ -0,0 +1,134 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "transcribe_checkpoint.hpp"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QSaveFile>
+#include <algorithm>
+
+transcribe_checkpoint::transcribe_checkpoint(const QString& dir,
+                                             const QString& file,
+                                             const QString& params)
+    : m_params{params}, m_last_save{std::chrono::steady_clock::now()} {
+    QFileInfo file_info{file};
+
+    m_file = file_info.canonicalFilePath();
+    if (m_file.isEmpty()) m_file = file_info.absoluteFilePath();
+    m_file_size = file_info.size();
+    m_file_mtime = file_info.lastModified().toMSecsSinceEpoch();
+
+    auto name = QString::fromLatin1(
+        QCryptographicHash::hash((m_file + '\n' + m_params).toUtf8(),
+                                 QCryptographicHash::Sha1)
+            .toHex());
+
+    QDir{}.mkpath(dir);
+    m_path = QDir{dir}.absoluteFilePath(name + QStringLiteral(".json"));
+
+    load();
+}
+
+void transcribe_checkpoint::load() {
+    QFile file{m_path};
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonParseError err;
+    auto json = QJsonDocument::fromJson(file.readAll(), &err);
+    file.close();
+
+    if (err.error != QJsonParseError::NoError) {
+        qWarning() << "failed to parse checkpoint:" << err.errorString();
+        remove();
+        return;
+    }
+
+    auto obj = json.object();
+
+    // hash collision or file changed after checkpoint was made
+    if (obj.value(QStringLiteral("file")).toString() != m_file ||
+        obj.value(QStringLiteral("params")).toString() != m_params ||
+        obj.value(QStringLiteral("file_size")).toVariant().toLongLong() !=
+            m_file_size ||
+        obj.value(QStringLiteral("file_mtime")).toVariant().toLongLong() !=
+            m_file_mtime) {
+        qDebug() << "checkpoint is outdated:" << m_file;
+        remove();
+        return;
+    }
+
+    m_offset_ms =
+        obj.value(QStringLiteral("offset_ms")).toVariant().toULongLong();
+    m_start_ms = m_offset_ms;
+
+    const auto texts = obj.value(QStringLiteral("texts")).toArray();
+    for (const auto& text : texts) m_texts.push_back(text.toString());
+
+    qDebug() << "checkpoint loaded:" << m_file
+             << "offset:" << m_offset_ms << "ms";
+}
+
+void transcribe_checkpoint::add_text(const QString& text,
+                                     uint64_t decoded_ms) {
+    m_texts.push_back(text);
+    m_offset_ms = std::max(m_offset_ms, m_start_ms + decoded_ms);
+    m_dirty = true;
+
+    if (std::chrono::steady_clock::now() - m_last_save >=
+        std::chrono::milliseconds{SAVE_INTERVAL})
+        save();
+}
+
+void transcribe_checkpoint::save() {
+    m_last_save = std::chrono::steady_clock::now();
+
+    if (!m_dirty) return;
+    m_dirty = false;
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("file"), m_file);
+    obj.insert(QStringLiteral("params"), m_params);
+    obj.insert(QStringLiteral("file_size"), m_file_size);
+    obj.insert(QStringLiteral("file_mtime"), m_file_mtime);
+    obj.insert(QStringLiteral("offset_ms"), static_cast<qint64>(m_offset_ms));
+    obj.insert(QStringLiteral("texts"), QJsonArray::fromStringList(m_texts));
+
+    // previous checkpoint stays valid if writing fails
+    QSaveFile file{m_path};
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "failed to open checkpoint file:" << m_path;
+        return;
+    }
+
+    file.write(QJsonDocument{obj}.toJson(QJsonDocument::Compact));
+
+    if (!file.commit()) {
+        qWarning() << "failed to write checkpoint file:" << m_path;
+        return;
+    }
+
+    qDebug() << "checkpoint saved:" << m_file << "offset:" << m_offset_ms
+             << "ms";
+}
+
+void transcribe_checkpoint::remove() {
+    m_texts.clear();
+    m_start_ms = 0;
+    m_offset_ms = 0;
+    m_dirty = false;
+
+    QFile::remove(m_path);
+}
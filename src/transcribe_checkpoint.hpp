@@ -0,0 +1,53 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef TRANSCRIBE_CHECKPOINT_HPP
+#define TRANSCRIBE_CHECKPOINT_HPP
+
+#include <QString>
+#include <QStringList>
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Progress of file transcription kept on disk, so that interrupted task can
+ * be continued from the last decoded position. Checkpoint is identified by
+ * file and engine params, and it is discarded when the file has been
+ * modified.
+ */
+class transcribe_checkpoint {
+   public:
+    // params should contain everything that has impact on decoded text
+    transcribe_checkpoint(const QString& dir, const QString& file,
+                          const QString& params);
+    // position in file where transcription should be continued
+    inline auto offset_ms() const { return m_offset_ms; }
+    // text decoded before offset
+    inline const auto& texts() const { return m_texts; }
+    // decoded_ms is counted from offset at which task was started
+    void add_text(const QString& text, uint64_t decoded_ms);
+    void save();
+    void remove();
+
+   private:
+    static const int SAVE_INTERVAL = 10000;  // 10s
+
+    QString m_path;
+    QString m_file;
+    QString m_params;
+    qint64 m_file_size = 0;
+    qint64 m_file_mtime = 0;
+    uint64_t m_start_ms = 0;
+    uint64_t m_offset_ms = 0;
+    QStringList m_texts;
+    bool m_dirty = false;
+    std::chrono::steady_clock::time_point m_last_save;
+
+    void load();
+};
+
+#endif  // TRANSCRIBE_CHECKPOINT_HPP
@@ -24,6 +24,7 @@
 #include <rubberband/RubberBandStretcher.h>
 #endif
 
+#include "dsp_tools.hpp"
 #include "logger.hpp"
 #include "media_compressor.hpp"
 
@@ -343,140 +344,160 @@ std::vector<tts_engine::task_t> tts_engine::make_tasks(const std::string& text,
     return tasks;
 }
 
-#ifdef ARCH_X86_64
-static void sample_buf_s16_to_f32(const int16_t* input, float* output,
-                                  size_t size) {
-    for (size_t i = 0; i < size; ++i)
-        output[i] = static_cast<float>(input[i]) / 32768.0F;
-}
+class tts_engine::wav_file_sink : public pcm_sink {
+   public:
+    explicit wav_file_sink(const std::string& file)
+        : m_wav_file{file, std::ios::binary} {
+        m_wav_file.seekp(sizeof(wav_header));
+    }
 
-static void sample_buf_f32_to_s16(const float* input, int16_t* output,
-                                  size_t size) {
-    for (size_t i = 0; i < size; ++i)
-        output[i] = static_cast<int16_t>(input[i] * 32768.0F);
-}
+    inline bool ok() const { return static_cast<bool>(m_wav_file); }
 
-bool tts_engine::stretch(const std::string& input_file,
-                         const std::string& output_file, double time_ration,
-                         double pitch_ratio) {
-    std::ifstream is{input_file, std::ios::binary | std::ios::ate};
-    if (!is) {
-        LOGE("failed to open input file for stretch: " << input_file);
-        return false;
+    void set_format(int sample_rate, int channels) override {
+        m_sample_rate = sample_rate;
+        m_channels = channels;
     }
 
-    std::ofstream os{output_file, std::ios::binary};
-    if (!os) {
-        LOGE("failed to open output file for stretch: " << output_file);
-        return false;
+    void write(const int16_t* samples, size_t count) override {
+        m_wav_file.write(reinterpret_cast<const char*>(samples),
+                         count * sizeof(int16_t));
+        m_num_samples += count;
     }
 
-    size_t size = is.tellg();
-    if (size < sizeof(wav_header)) {
-        LOGE("file header is too short");
-        os.close();
-        unlink(output_file.c_str());
-        return false;
+    bool finish() override {
+        if (m_num_samples == 0) {
+            LOGE("no audio data");
+            return false;
+        }
+
+        if (m_sample_rate <= 0 || m_channels <= 0) {
+            LOGE("invalid audio format");
+            return false;
+        }
+
+        m_wav_file.seekp(0);
+        write_wav_header(m_sample_rate, sizeof(int16_t), m_channels,
+                         m_num_samples / m_channels, m_wav_file);
+        m_wav_file.close();
+
+        if (!m_wav_file) {
+            LOGE("failed to write wav file");
+            return false;
+        }
+
+        return true;
     }
 
-    is.seekg(0, std::ios::beg);
-    auto header = read_wav_header(is);
+   private:
+    std::ofstream m_wav_file;
+    int m_sample_rate = 0;
+    int m_channels = 0;
+    uint32_t m_num_samples = 0;
+};
 
-    if (header.num_channels != 1) {
-        LOGE("stretching is supported only for mono");
-        os.close();
-        unlink(output_file.c_str());
-        return false;
+#ifdef ARCH_X86_64
+class tts_engine::stretch_sink : public pcm_sink {
+   public:
+    stretch_sink(pcm_sink& next_sink, double time_ratio)
+        : m_next_sink{next_sink}, m_time_ratio{time_ratio} {}
+
+    void set_format(int sample_rate, int channels) override {
+        m_sample_rate = sample_rate;
+        m_channels = channels;
+        m_next_sink.set_format(sample_rate, channels);
     }
 
-    size -= is.tellg();
-
-    LOGD("stretcher sample rate: " << header.sample_rate);
-
-    RubberBand::RubberBandStretcher rb{
-        header.sample_rate, /*mono*/ 1,
-        RubberBand::RubberBandStretcher::DefaultOptions |
-            RubberBand::RubberBandStretcher::OptionProcessOffline |
-            RubberBand::RubberBandStretcher::OptionEngineFiner |
-            RubberBand::RubberBandStretcher::OptionSmoothingOn |
-            RubberBand::RubberBandStretcher::OptionTransientsSmooth |
-            RubberBand::RubberBandStretcher::OptionWindowLong,
-        time_ration, pitch_ratio};
-
-    static const size_t buf_c_size = 8192;
-    static const size_t buf_f_size = 4096;
-
-    char buf_c[buf_c_size];
-    float buf_f[buf_f_size];
-    float* buf_f_ptr[2] = {buf_f, nullptr};  // mono
-
-    while (is) {
-        const auto size_to_read = std::min<size_t>(size, buf_c_size);
-        const auto size_to_write = size_to_read / sizeof(int16_t);
-        is.read(buf_c, size_to_read);
-        sample_buf_s16_to_f32(reinterpret_cast<int16_t*>(buf_c), buf_f,
-                              size_to_write);
-        float* buf_f_c[2] = {buf_f, nullptr};
-        rb.study(buf_f_c, size_to_write, !static_cast<bool>(is));
+    void write(const int16_t* samples, size_t count) override {
+        // offline stretching needs whole input, samples are kept in memory
+        m_samples.insert(m_samples.end(), samples, samples + count);
     }
 
-    is.clear();
-    is.seekg(sizeof(wav_header), std::ios::beg);
-    os.seekp(sizeof(wav_header));
-
-    while (is) {
-        const auto size_to_read = std::min<size_t>(size, buf_c_size);
-        const auto size_to_write = size_to_read / sizeof(int16_t);
-        is.read(buf_c, size_to_read);
-        sample_buf_s16_to_f32(reinterpret_cast<int16_t*>(buf_c), buf_f,
-                              size_to_write);
-        rb.process(buf_f_ptr, size_to_write, !is);
-
-        while (true) {
-            auto size_rb = rb.available();
-            if (size_rb <= 0) break;
-
-            auto size_r =
-                rb.retrieve(buf_f_ptr, std::min<size_t>(size_rb, buf_f_size));
-            if (size_r == 0) break;
-
-            sample_buf_f32_to_s16(buf_f, reinterpret_cast<int16_t*>(buf_c),
-                                  size_r);
-            os.write(buf_c, size_r * sizeof(int16_t));
+    bool finish() override {
+        if (m_channels != 1) {
+            LOGE("stretching is supported only for mono");
+        } else if (!m_samples.empty()) {
+            stretch();
+            return m_next_sink.finish();
         }
+
+        m_next_sink.write(m_samples.data(), m_samples.size());
+        return m_next_sink.finish();
     }
 
-    auto data_size = static_cast<size_t>(os.tellp()) - sizeof(wav_header);
+   private:
+    static constexpr size_t buf_size = 4096;
+
+    pcm_sink& m_next_sink;
+    double m_time_ratio = 1.0;
+    int m_sample_rate = 0;
+    int m_channels = 0;
+    std::vector<int16_t> m_samples;
+
+    void stretch() {
+        LOGD("stretcher sample rate: " << m_sample_rate);
+
+        RubberBand::RubberBandStretcher rb{
+            static_cast<size_t>(m_sample_rate), /*mono*/ 1,
+            RubberBand::RubberBandStretcher::DefaultOptions |
+                RubberBand::RubberBandStretcher::OptionProcessOffline |
+                RubberBand::RubberBandStretcher::OptionEngineFiner |
+                RubberBand::RubberBandStretcher::OptionSmoothingOn |
+                RubberBand::RubberBandStretcher::OptionTransientsSmooth |
+                RubberBand::RubberBandStretcher::OptionWindowLong,
+            m_time_ratio, 1.0};
+
+        float buf_f[buf_size];
+        int16_t buf_s[buf_size];
+        float* buf_f_ptr[2] = {buf_f, nullptr};  // mono
+
+        for (size_t pos = 0; pos < m_samples.size(); pos += buf_size) {
+            auto size = std::min(buf_size, m_samples.size() - pos);
+            dsp_tools::s16_to_f32(m_samples.data() + pos, buf_f, size);
+            rb.study(buf_f_ptr, size, pos + size == m_samples.size());
+        }
 
-    if (data_size == 0) {
-        os.close();
-        unlink(output_file.c_str());
-        return false;
-    }
+        for (size_t pos = 0; pos < m_samples.size(); pos += buf_size) {
+            auto size = std::min(buf_size, m_samples.size() - pos);
+            dsp_tools::s16_to_f32(m_samples.data() + pos, buf_f, size);
+            rb.process(buf_f_ptr, size, pos + size == m_samples.size());
 
-    os.seekp(0);
-    write_wav_header(header.sample_rate, sizeof(int16_t), 1,
-                     data_size / sizeof(int16_t), os);
+            while (true) {
+                auto size_rb = rb.available();
+                if (size_rb <= 0) break;
 
-    return true;
-}
+                auto size_r = rb.retrieve(
+                    buf_f_ptr, std::min<size_t>(size_rb, buf_size));
+                if (size_r == 0) break;
+
+                dsp_tools::f32_to_s16(buf_f, buf_s, size_r);
+                m_next_sink.write(buf_s, size_r);
+            }
+        }
+    }
+};
 #endif  // ARCH_X86_64
 
-void tts_engine::apply_speed([[maybe_unused]] const std::string& file) const {
-#ifdef ARCH_X86_64
-    auto tmp_file = file + "_tmp";
+bool tts_engine::encode_speech_to_file(const std::string& text,
+                                       const std::string& out_file) {
+    wav_file_sink file_sink{out_file};
 
-    if (m_config.speech_speed > 0 && m_config.speech_speed <= 20 &&
-        m_config.speech_speed != 10) {
+    if (!file_sink.ok()) {
+        LOGE("failed to open file for writing: " << out_file);
+        return false;
+    }
+
+#ifdef ARCH_X86_64
+    if (!model_supports_speed() && m_config.speech_speed > 0 &&
+        m_config.speech_speed <= 20 && m_config.speech_speed != 10) {
         auto speech_speed = 20 - (m_config.speech_speed - 1);
 
-        if (stretch(file, tmp_file, static_cast<double>(speech_speed) / 10.0,
-                    1.0)) {
-            unlink(file.c_str());
-            rename(tmp_file.c_str(), file.c_str());
-        }
+        stretch_sink sink{file_sink, static_cast<double>(speech_speed) / 10.0};
+
+        return encode_speech_impl(text, sink) && sink.finish();
     }
 #endif  // ARCH_X86_64
+
+    return encode_speech_impl(text, file_sink) && file_sink.finish();
 }
 
 void tts_engine::process() {
@@ -540,7 +561,8 @@ void tts_engine::process() {
                         ? output_file
                         : output_file + ".wav";
 
-                if (!encode_speech_impl(new_text, output_file_wav)) {
+                if (!encode_speech_to_file(new_text, output_file_wav)) {
+                    unlink(output_file_wav.c_str());
                     unlink(output_file.c_str());
                     LOGE("speech encoding error");
                     if (m_call_backs.speech_encoded) {
@@ -551,8 +573,6 @@ void tts_engine::process() {
                     continue;
                 }
 
-                if (!model_supports_speed()) apply_speed(output_file_wav);
-
                 if (m_config.audio_format != audio_format_t::wav) {
                     media_compressor{}.compress(
                         {output_file_wav}, output_file,
@@ -606,14 +626,6 @@ void tts_engine::write_wav_header(int sample_rate, int sample_width,
     wav_file.write(reinterpret_cast<const char*>(&header), sizeof(wav_header));
 }
 
-tts_engine::wav_header tts_engine::read_wav_header(std::ifstream& wav_file) {
-    wav_header header;
-    if (!wav_file.read(reinterpret_cast<char*>(&header), sizeof(wav_header)))
-        throw std::runtime_error("failed to read file");
-
-    return header;
-}
-
 float tts_engine::vits_length_scale(unsigned int speech_speed,
                                     float initial_length_scale) {
     return initial_length_scale *
@@ -9,6 +9,7 @@
 #define TTS_ENGINE_HPP
 
 #include <condition_variable>
+#include <cstdint>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -65,6 +66,17 @@ class tts_engine {
     friend std::ostream& operator<<(std::ostream& os,
                                     const model_files_t& model_files);
 
+    // receives s16 samples of speech as they are synthesized
+    class pcm_sink {
+       public:
+        virtual ~pcm_sink() = default;
+        // must be called before finish, may be called after first samples
+        virtual void set_format(int sample_rate, int channels) = 0;
+        virtual void write(const int16_t* samples, size_t count) = 0;
+        // false when no samples were written or output failed
+        virtual bool finish() = 0;
+    };
+
     struct callbacks_t {
         std::function<void(const std::string& text,
                            const std::string& audio_file_path,
@@ -137,6 +149,13 @@ class tts_engine {
         bool last = false;
     };
 
+    // writes samples to WAV file
+    class wav_file_sink;
+#ifdef ARCH_X86_64
+    // changes tempo of speech and passes samples to next sink
+    class stretch_sink;
+#endif
+
     config_t m_config;
     callbacks_t m_call_backs;
     std::thread m_processing_thread;
@@ -156,7 +175,6 @@ class tts_engine {
     static void write_wav_header(int sample_rate, int sample_width,
                                  int channels, uint32_t num_samples,
                                  std::ofstream& wav_file);
-    static wav_header read_wav_header(std::ifstream& wav_file);
     static float vits_length_scale(unsigned int speech_speed,
                                    float initial_length_scale);
     static float overflow_duration_threshold(unsigned int speech_speed,
@@ -165,19 +183,15 @@ class tts_engine {
     virtual bool model_supports_speed() const = 0;
     virtual void create_model() = 0;
     virtual bool encode_speech_impl(const std::string& text,
-                                    const std::string& out_file) = 0;
+                                    pcm_sink& sink) = 0;
     void set_state(state_t new_state);
     std::string path_to_output_file(const std::string& text) const;
     void process();
     std::vector<task_t> make_tasks(const std::string& text,
                                    bool split = true) const;
-    void apply_speed(const std::string& file) const;
+    bool encode_speech_to_file(const std::string& text,
+                               const std::string& out_file);
     void setup_ref_voice();
-#ifdef ARCH_X86_64
-    static bool stretch(const std::string& input_file,
-                        const std::string& output_file, double time_ration,
-                        double pitch_ratio);
-#endif
 };
 
 #endif // TTS_ENGINE_HPP
@@ -0,0 +1,368 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "tts_player.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+tts_player::tts_player(QObject* parent) : QIODevice{parent} {
+    m_events_timer.setInterval(EVENTS_INTERVAL);
+    connect(&m_events_timer, &QTimer::timeout, this,
+            &tts_player::handle_events_timeout);
+
+    open(QIODevice::ReadOnly);
+}
+
+tts_player::~tts_player() {
+    stop();
+    close();
+}
+
+QAudioFormat tts_player::make_pcm_format(int sample_rate, int channels) {
+    QAudioFormat format;
+    format.setSampleRate(sample_rate);
+    format.setChannelCount(channels);
+    format.setSampleSize(16);
+    format.setCodec(QStringLiteral("audio/pcm"));
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setSampleType(QAudioFormat::SignedInt);
+
+    return format;
+}
+
+bool tts_player::load_wav(segment_t& segment) {
+    QFile file{segment.file};
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    auto data = file.readAll();
+    if (data.size() < 12 || !data.startsWith("RIFF") ||
+        data.mid(8, 4) != "WAVE")
+        return false;
+
+    const auto* ptr = reinterpret_cast<const uchar*>(data.constData());
+    int fmt_tag = 0;
+    int channels = 0;
+    int sample_rate = 0;
+    int bits = 0;
+
+    qint64 pos = 12;
+    while (pos + 8 <= data.size()) {
+        auto id = data.mid(static_cast<int>(pos), 4);
+        qint64 size = qFromLittleEndian<quint32>(ptr + pos + 4);
+        pos += 8;
+
+        if (id == "fmt ") {
+            if (size < 16 || pos + 16 > data.size()) return false;
+            fmt_tag = qFromLittleEndian<quint16>(ptr + pos);
+            channels = qFromLittleEndian<quint16>(ptr + pos + 2);
+            sample_rate =
+                static_cast<int>(qFromLittleEndian<quint32>(ptr + pos + 4));
+            bits = qFromLittleEndian<quint16>(ptr + pos + 14);
+        } else if (id == "data") {
+            // only s16 samples can be played without conversion
+            if (fmt_tag != 1 || bits != 16 || channels < 1 || channels > 2 ||
+                sample_rate <= 0)
+                return false;
+
+            // size is not set when file was written as stream
+            auto end = std::min<qint64>(data.size(), pos + size);
+            end -= (end - pos) % (channels * 2);
+
+            segment.pos = static_cast<int>(pos);
+            segment.end = static_cast<int>(end);
+            segment.pcm = std::move(data);
+            segment.pcm_format = make_pcm_format(sample_rate, channels);
+
+            return true;
+        }
+
+        pos += size + (size & 1);
+    }
+
+    return false;
+}
+
+void tts_player::prepare_segment(segment_t& segment) {
+    segment.prepared = true;
+
+    if (segment.format == tts_engine::audio_format_t::wav && load_wav(segment))
+        return;
+
+    try {
+        segment.decoder = std::make_unique<media_compressor>();
+        segment.decoder->decompress_to_raw_async(
+            {segment.file.toStdString()},
+            /*mono_16khz=*/false, {}, {});
+
+        auto format = segment.decoder->raw_format();
+        segment.pcm_format =
+            make_pcm_format(format.sample_rate, format.channels);
+    } catch (const std::runtime_error& err) {
+        qWarning() << "failed to decode speech audio:" << err.what();
+        segment.decoder.reset();
+    }
+}
+
+void tts_player::prepare_segments() {
+    auto count = std::min<size_t>(m_segments.size(), PREPARED_SEGMENTS);
+    for (size_t i = 0; i < count; ++i) {
+        if (!m_segments[i].prepared) prepare_segment(m_segments[i]);
+    }
+}
+
+std::pair<qint64, bool> tts_player::read_segment(segment_t& segment,
+                                                 char* data,
+                                                 qint64 max_size) {
+    if (segment.decoder) {
+        auto info = segment.decoder->get_data(data, max_size);
+        return {static_cast<qint64>(info.size),
+                info.eof || segment.decoder->error()};
+    }
+
+    auto size = std::min<qint64>(max_size, segment.end - segment.pos);
+    if (size > 0) {
+        std::memcpy(data, segment.pcm.constData() + segment.pos, size);
+        segment.pos += static_cast<int>(size);
+    }
+
+    return {size, segment.pos >= segment.end};
+}
+
+void tts_player::enqueue(const QString& file,
+                         tts_engine::audio_format_t format) {
+    auto& segment = m_segments.emplace_back();
+    segment.file = file;
+    segment.format = format;
+
+    prepare_segments();
+
+    if (!m_output || m_output->state() == QAudio::StoppedState)
+        start_output();
+    else
+        update_state();
+}
+
+void tts_player::start_output() {
+    if (m_paused || m_segments.empty()) return;
+
+    auto& segment = m_segments.front();
+    if (!segment.prepared) prepare_segment(segment);
+
+    auto format = segment.pcm_format;
+    if (!format.isValid())
+        format = m_output ? m_output_format : make_pcm_format(22050, 1);
+
+    if (!m_output || format != m_output_format) {
+        if (m_output) m_output->stop();
+
+        qDebug() << "creating audio output:" << format;
+
+        m_output_format = format;
+        m_output = std::make_unique<QAudioOutput>(m_output_format);
+        connect(m_output.get(), &QAudioOutput::stateChanged, this,
+                &tts_player::handle_output_state_changed);
+    }
+
+    if (m_output->state() == QAudio::StoppedState) {
+        m_written = 0;
+        m_output->start(this);
+    }
+
+    m_events_timer.start();
+
+    update_state();
+}
+
+qint64 tts_player::readData(char* data, qint64 max_size) {
+    qint64 total = 0;
+
+    while (total < max_size && !m_segments.empty() &&
+           !m_format_change_pending) {
+        auto& segment = m_segments.front();
+        if (!segment.prepared) prepare_segment(segment);
+
+        if (segment.pcm_format.isValid() &&
+            segment.pcm_format != m_output_format) {
+            // output is recreated when audio queued so far has been played
+            m_format_change_pending = true;
+            m_events.push_back(
+                {event_t::type_t::format_changed, m_written + total});
+            break;
+        }
+
+        if (!segment.started) {
+            segment.started = true;
+            m_events.push_back(
+                {event_t::type_t::segment_started, m_written + total});
+        }
+
+        auto [size, eof] =
+            read_segment(segment, data + total, max_size - total);
+        total += size;
+
+        // decoder is behind playback
+        if (!eof) break;
+
+        m_segments.pop_front();
+        m_events.push_back(
+            {event_t::type_t::segment_finished, m_written + total});
+
+        // opening of file should not delay filling of output buffer
+        QTimer::singleShot(0, this, &tts_player::prepare_segments);
+    }
+
+    m_written += total;
+
+    return total;
+}
+
+qint64 tts_player::writeData([[maybe_unused]] const char* data,
+                             [[maybe_unused]] qint64 max_size) {
+    return -1;
+}
+
+void tts_player::handle_events_timeout() {
+    if (!m_output) return;
+
+    // data handed over to audio output is not played yet
+    auto buffered =
+        std::max(0, m_output->bufferSize() - m_output->bytesFree());
+    auto played = m_written - buffered;
+
+    while (!m_events.empty() && m_events.front().pos <= played) {
+        auto event = m_events.front();
+
+        // output is recreated when it has played all queued audio
+        if (event.type == event_t::type_t::format_changed && !output_drained())
+            break;
+
+        m_events.pop_front();
+
+        switch (event.type) {
+            case event_t::type_t::segment_started:
+                emit segment_started();
+                break;
+            case event_t::type_t::segment_finished:
+                emit segment_finished();
+                break;
+            case event_t::type_t::format_changed:
+                m_format_change_pending = false;
+                m_output->stop();
+                start_output();
+                return;
+        }
+    }
+
+    update_state();
+}
+
+void tts_player::handle_output_state_changed(QAudio::State new_state) {
+    qDebug() << "audio output new state:" << new_state;
+
+    if (new_state != QAudio::StoppedState) return;
+
+    auto error = m_output->error();
+    if (error == QAudio::NoError || error == QAudio::UnderrunError) return;
+
+    qWarning() << "audio output error:" << error;
+
+    discard_segments();
+}
+
+void tts_player::discard_segments() {
+    // queues are taken before emitting because receivers are allowed to
+    // enqueue or stop
+    auto events = std::move(m_events);
+    auto segments = std::move(m_segments);
+    m_events.clear();
+    m_segments.clear();
+    m_format_change_pending = false;
+
+    // segments are reported as played so that queue is not blocked
+    for (const auto& event : events) {
+        if (event.type == event_t::type_t::segment_started)
+            emit segment_started();
+        else if (event.type == event_t::type_t::segment_finished)
+            emit segment_finished();
+    }
+
+    for (const auto& segment : segments) {
+        if (!segment.started) emit segment_started();
+        emit segment_finished();
+    }
+
+    update_state();
+}
+
+void tts_player::pause() {
+    m_paused = true;
+
+    if (m_output && m_output->state() != QAudio::StoppedState)
+        m_output->suspend();
+
+    update_state();
+}
+
+void tts_player::resume() {
+    m_paused = false;
+
+    if (m_output && m_output->state() == QAudio::SuspendedState)
+        m_output->resume();
+    else
+        start_output();
+
+    update_state();
+}
+
+void tts_player::stop() {
+    m_events.clear();
+    m_segments.clear();
+    m_format_change_pending = false;
+    m_paused = false;
+    m_written = 0;
+
+    if (m_output) m_output->stop();
+
+    update_state();
+}
+
+bool tts_player::output_drained() const {
+    if (!m_output || m_output->state() == QAudio::StoppedState) return true;
+
+    return m_output->state() == QAudio::IdleState &&
+           m_output->bytesFree() == m_output->bufferSize();
+}
+
+void tts_player::update_state() {
+    auto new_state = [&] {
+        if (m_paused) return state_t::paused;
+        if (m_segments.empty() && m_events.empty()) return state_t::idle;
+        return state_t::playing;
+    }();
+
+    if (new_state == state_t::idle) {
+        if (output_drained()) {
+            m_events_timer.stop();
+            if (m_output && m_output->state() != QAudio::StoppedState)
+                m_output->stop();
+        } else if (!m_events_timer.isActive()) {
+            // stopping output now would cut off end of last segment
+            m_events_timer.start();
+        }
+    }
+
+    if (new_state != m_state) {
+        qDebug() << "tts player new state:" << static_cast<int>(new_state);
+        m_state = new_state;
+        emit state_changed();
+    }
+}
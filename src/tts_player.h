@@ -0,0 +1,106 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef TTS_PLAYER_H
+#define TTS_PLAYER_H
+
+#include <QAudioFormat>
+#include <QAudioOutput>
+#include <QByteArray>
+#include <QIODevice>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include "media_compressor.hpp"
+#include "tts_engine.hpp"
+
+/*
+ * Gapless playback of synthesized speech. Queued segments are pulled by
+ * audio output straight from memory. Samples of WAV files are used as they
+ * are, other formats are decoded on the fly while previous segment is
+ * playing. Segment signals are emitted when audio is actually played, not
+ * when it is handed over to audio output.
+ */
+class tts_player : public QIODevice {
+    Q_OBJECT
+   public:
+    enum class state_t { idle, playing, paused };
+
+    explicit tts_player(QObject* parent = nullptr);
+    ~tts_player() override;
+    void enqueue(const QString& file, tts_engine::audio_format_t format);
+    void pause();
+    void resume();
+    // drops all queued segments without emitting signals
+    void stop();
+    inline state_t state() const { return m_state; }
+    inline bool isSequential() const override { return true; }
+
+   signals:
+    void segment_started();
+    void segment_finished();
+    void state_changed();
+
+   protected:
+    qint64 readData(char* data, qint64 max_size) override;
+    qint64 writeData(const char* data, qint64 max_size) override;
+
+   private:
+    static const int EVENTS_INTERVAL = 20;   // 20ms
+    static const int PREPARED_SEGMENTS = 2;  // current and next
+
+    struct segment_t {
+        QString file;
+        tts_engine::audio_format_t format = tts_engine::audio_format_t::wav;
+        bool prepared = false;
+        bool started = false;
+        QAudioFormat pcm_format;
+        // whole WAV file, samples are between pos and end
+        QByteArray pcm;
+        int pos = 0;
+        int end = 0;
+        // used for non-WAV files and WAV files with non-s16 samples
+        std::unique_ptr<media_compressor> decoder;
+    };
+
+    struct event_t {
+        enum class type_t { segment_started, segment_finished, format_changed };
+
+        type_t type = type_t::segment_started;
+        // position in output stream when event is due
+        qint64 pos = 0;
+    };
+
+    std::deque<segment_t> m_segments;
+    std::deque<event_t> m_events;
+    std::unique_ptr<QAudioOutput> m_output;
+    QAudioFormat m_output_format;
+    qint64 m_written = 0;
+    bool m_format_change_pending = false;
+    bool m_paused = false;
+    state_t m_state = state_t::idle;
+    QTimer m_events_timer;
+
+    static QAudioFormat make_pcm_format(int sample_rate, int channels);
+    static bool load_wav(segment_t& segment);
+    void prepare_segments();
+    void prepare_segment(segment_t& segment);
+    std::pair<qint64, bool> read_segment(segment_t& segment, char* data,
+                                         qint64 max_size);
+    void start_output();
+    void handle_output_state_changed(QAudio::State new_state);
+    void handle_events_timeout();
+    void discard_segments();
+    bool output_drained() const;
+    void update_state();
+};
+
+#endif  // TTS_PLAYER_H
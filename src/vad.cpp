@@ -10,37 +10,131 @@
 #include <webrtc_vad.h>
 
 #include <algorithm>
-#include <numeric>
 #include <stdexcept>
-#include <vector>
 
+#include "dsp_tools.hpp"
 #include "logger.hpp"
+#include "silero_vad.hpp"
+
+std::ostream& operator<<(std::ostream& os, vad::backend_t backend) {
+    switch (backend) {
+        case vad::backend_t::webrtc:
+            os << "webrtc";
+            break;
+        case vad::backend_t::silero:
+            os << "silero";
+            break;
+    }
+
+    return os;
+}
 
-vad::vad() { restart(); }
+namespace {
+class webrtc_detector : public vad::detector {
+   public:
+    explicit webrtc_detector(int mode) {
+        m_handle = WebRtcVad_Create();
 
-void vad::restart() {
-    if (m_handle) WebRtcVad_Free(m_handle);
+        if (m_handle == nullptr) throw std::runtime_error("vad create error");
+
+        if (WebRtcVad_Init(m_handle) != 0) {
+            WebRtcVad_Free(m_handle);
+            throw std::runtime_error("vad init error");
+        }
+
+        if (WebRtcVad_set_mode(m_handle, mode) != 0) {
+            WebRtcVad_Free(m_handle);
+            throw std::runtime_error("set mode error");
+        }
+    }
+
+    ~webrtc_detector() override { WebRtcVad_Free(m_handle); }
+
+    size_t chunk_size() const override { return m_chunk_size; }
+
+    bool is_speech(const vad::buf_t::value_type* chunk) override {
+        auto result = WebRtcVad_Process(m_handle, m_fs, chunk, m_chunk_size);
+
+        if (result < 0) throw std::runtime_error("process error");
+
+        return result == 1;
+    }
 
-    m_handle = WebRtcVad_Create();
+    // noise estimation adapts continuously, no need to clear it
+    void reset() override {}
 
-    if (m_handle == nullptr) throw std::runtime_error("vad create error");
+   private:
+    inline static const size_t m_chunk_size = 480;
+    inline static const int m_fs = 16000;
+    WebRtcVadInst* m_handle = nullptr;
+};
+}  // namespace
 
-    if (WebRtcVad_Init(m_handle) != 0)
-        throw std::runtime_error("vad init error");
+vad::vad() : vad{config_t{}} {}
 
-    if (WebRtcVad_set_mode(m_handle, m_mode) != 0)
-        throw std::runtime_error("set mode error");
+vad::vad(config_t config) : m_config{std::move(config)} {
+    m_output_samples.reserve(m_history_size);
+    restart();
+}
+
+void vad::make_detector() {
+    m_detector.reset();
+
+    if (m_config.backend == backend_t::silero) {
+        try {
+            m_detector =
+                std::make_unique<silero_vad>(m_config.silero_model_file);
+            m_backend = backend_t::silero;
+        } catch (const std::exception& err) {
+            LOGE("failed to create silero vad, fallback to webrtc: "
+                 << err.what());
+        }
+    }
+
+    if (!m_detector) {
+        m_detector = std::make_unique<webrtc_detector>(
+            std::clamp(m_config.webrtc_mode, 0, 3));
+        m_backend = backend_t::webrtc;
+    }
+
+    m_chunk_size = m_detector->chunk_size();
+    if (m_chunk_size == 0 || m_chunk_size > m_chunk_max_size)
+        throw std::runtime_error("invalid vad chunk size");
+
+    m_window_chunks = std::min(duration_to_chunks(m_config.onset_ms),
+                               m_window_max_chunks);
+    m_hangover_chunks = duration_to_chunks(m_config.hangover_ms);
 
+    LOGD("vad backend: " << m_backend << ", chunk size=" << m_chunk_size
+                         << ", onset chunks=" << m_window_chunks
+                         << ", hangover chunks=" << m_hangover_chunks);
+}
+
+void vad::restart() {
+    make_detector();
     reset();
 }
 
 void vad::reset() {
     m_output_samples.clear();
-    m_input_samples.clear();
-    m_dup_size = 0;
+    m_history.clear();
+    m_chunk_fill = 0;
+    clear_votes();
+    m_silence_chunks = 0;
+    m_active = false;
+    m_speech_ended = false;
+    m_detector->reset();
+}
+
+size_t vad::duration_to_chunks(unsigned int duration_ms) const {
+    auto samples = static_cast<size_t>(duration_ms) * 16;  // 16kHz
+    return std::max<size_t>(1, (samples + m_chunk_size / 2) / m_chunk_size);
 }
 
-vad::~vad() { WebRtcVad_Free(m_handle); }
+void vad::set_hangover(unsigned int hangover_ms) {
+    m_config.hangover_ms = hangover_ms;
+    m_hangover_chunks = duration_to_chunks(hangover_ms);
+}
 
 void vad::shift_left(std::vector<int16_t>& vec, size_t distance) {
     if (distance >= vec.size()) {
@@ -56,40 +150,74 @@ void vad::shift_left(std::vector<int16_t>& vec, size_t distance) {
     vec.resize(vec.size() - distance);
 }
 
-[[maybe_unused]] static void log_vec(const std::vector<bool>& vec) {
-    std::ostringstream os;
-    std::for_each(vec.cbegin(), vec.cend(), [&os](auto value) { os << value; });
-    LOGD("results: " << os.str());
+bool vad::classify_chunk() {
+    if (m_config.energy_gate_peak > 0 &&
+        dsp_tools::peak(m_chunk.data(), m_chunk_size) <
+            m_config.energy_gate_peak)
+        return false;
+
+    return m_detector->is_speech(m_chunk.data());
 }
 
-static void insert_to_vec(const std::vector<int16_t>& input, size_t start,
-                          size_t stop, std::vector<int16_t>& output) {
-    auto beg = input.begin();
-    std::advance(beg, start);
+void vad::push_vote(bool speech) {
+    if (m_vote_size == m_window_chunks) {
+        if (m_votes[m_vote_idx]) --m_vote_count;
+    } else {
+        ++m_vote_size;
+    }
+
+    m_votes[m_vote_idx] = speech;
+    if (speech) ++m_vote_count;
 
-    auto end = input.begin();
-    std::advance(end, stop);
+    m_vote_idx = (m_vote_idx + 1) % m_window_chunks;
+}
 
-    output.insert(output.end(), beg, end);
+void vad::clear_votes() {
+    m_votes.fill(false);
+    m_vote_idx = 0;
+    m_vote_size = 0;
+    m_vote_count = 0;
 }
 
-std::vector<bool> vad::vad_process(const buf_t& samples) const {
-    const auto chunks = samples.size() / m_chunk_size;
+void vad::move_history_to_output(size_t size) {
+    auto offset = m_output_samples.size();
+    m_output_samples.resize(offset + size);
+    m_history.read(m_output_samples.data() + offset, size);
+}
 
-    std::vector<bool> results;
-    results.reserve(chunks);
+void vad::process_chunk() {
+    auto speech = classify_chunk();
 
-    for (size_t chunk = 0; chunk < chunks; ++chunk) {
-        auto result = WebRtcVad_Process(m_handle, m_fs,
-                                        samples.data() + (chunk * m_chunk_size),
-                                        m_chunk_size);
+    if (m_active) {
+        m_silence_chunks = speech ? 0 : m_silence_chunks + 1;
 
-        if (result < 0) throw std::runtime_error("process error");
+        move_history_to_output(m_history.size());
 
-        results.push_back(result == 1);
+        if (m_silence_chunks >= m_hangover_chunks) {
+            LOGT("speech end: silence chunks=" << m_silence_chunks);
+            m_active = false;
+            m_speech_ended = true;
+            // next speech needs full onset window after this end
+            clear_votes();
+        }
+
+        return;
     }
 
-    return results;
+    push_vote(speech);
+
+    if (m_vote_size == m_window_chunks && 2 * m_vote_count > m_window_chunks) {
+        LOGT("speech start: votes=" << m_vote_count);
+        // speech starts with the first chunk of onset window
+        m_active = true;
+        m_speech_ended = false;
+        m_silence_chunks = 0;
+        move_history_to_output(m_history.size());
+    } else if (auto window_size = m_window_chunks * m_chunk_size;
+               m_history.size() > window_size) {
+        // samples older than onset window are silence
+        m_history.commit_read(m_history.size() - window_size);
+    }
 }
 
 bool vad::is_speech(const buf_t::value_type* frame, size_t frame_size) {
@@ -99,93 +227,31 @@ bool vad::is_speech(const buf_t::value_type* frame, size_t frame_size) {
 const vad::buf_t& vad::remove_silence(const buf_t::value_type* frame,
                                       size_t frame_size) {
     m_output_samples.clear();
+    m_speech_ended = false;
 
-    for (size_t i = 0; i < frame_size; ++i) m_input_samples.push_back(frame[i]);
-
-    if (m_input_samples.size() < m_chunk_size) return m_output_samples;
-
-    LOGT("input samples: size=" << m_input_samples.size());
-
-    auto vad_results = vad_process(m_input_samples);
-
-    if (vad_results.size() < m_chunks_in_frame) return m_output_samples;
-
-    std::optional<size_t> cut_start;
-    std::optional<size_t> cut_stop;
-
-    for (size_t chunk = 0; chunk <= (vad_results.size() - m_chunks_in_frame);
-         ++chunk) {
-        auto beg = vad_results.cbegin();
-        std::advance(beg, chunk);
-
-        auto end = beg;
-        std::advance(end, m_chunks_in_frame);
-
-        auto acc = std::accumulate(beg, end, static_cast<size_t>(0),
-                                   [](size_t sum, bool value) {
-                                       if (value) ++sum;
-                                       return sum;
-                                   });
+    size_t done = 0;
 
-        auto vad_active = 2 * acc > m_chunks_in_frame;
+    while (done < frame_size) {
+        auto size = std::min(m_chunk_size - m_chunk_fill, frame_size - done);
 
-        if (vad_active && !cut_start) {
-            auto pos = std::min(chunk * m_chunk_size, m_input_samples.size());
-            LOGT("cut start: pos=" << pos << ", m_dup_size=" << m_dup_size);
+        std::copy(frame + done, frame + done + size,
+                  m_chunk.begin() + m_chunk_fill);
+        m_history.write(frame + done, size);
 
-            if (pos == 0) {
-                pos = std::min(pos + m_dup_size, m_input_samples.size());
-                m_dup_size = 0;
-            }
+        m_chunk_fill += size;
+        done += size;
 
-            cut_start.emplace(pos);
-
-            LOGT("cut start: " << *cut_start << ", chunk=" << chunk
-                               << ", m_chunk_size=" << m_chunk_size);
-        }
-
-        if (!vad_active && cut_start) {
-            auto pos = std::min((chunk + m_chunks_in_frame) * m_chunk_size,
-                                m_input_samples.size());
-            LOGT("cut stop: pos=" << pos);
-
-            if (pos > *cut_start) {
-                cut_stop.emplace(pos);
-
-                LOGT("cut stop: " << *cut_stop << ", chunk=" << chunk
-                                  << ", m_chunk_size=" << m_chunk_size);
-
-                insert_to_vec(m_input_samples, *cut_start, *cut_stop,
-                              m_output_samples);
-
-                cut_start.reset();
-                chunk += m_chunks_in_frame;
-            }
+        if (m_chunk_fill == m_chunk_size) {
+            process_chunk();
+            m_chunk_fill = 0;
+        } else if (m_active) {
+            move_history_to_output(m_history.size());
         }
     }
 
-    m_dup_size = 0;
-
-    auto dup_size = m_input_samples.size() <= m_dup_max_size
-                        ? m_dup_max_size - m_input_samples.size()
-                        : m_dup_max_size;
-
-    if (cut_start) {
-        cut_stop.emplace(m_input_samples.size());
-
-        LOGT("cut stop: " << *cut_stop);
-
-        insert_to_vec(m_input_samples, *cut_start, *cut_stop, m_output_samples);
-    }
-
-    if (cut_stop) {
-        auto not_cut = m_input_samples.size() - *cut_stop;
-        if (not_cut < dup_size) m_dup_size = dup_size - not_cut;
-    }
-
-    LOGT("dup: added size=" << dup_size << ", to remove size=" << m_dup_size);
-
-    shift_left(m_input_samples, m_input_samples.size() - dup_size);
+    LOGT("vad: input size=" << frame_size
+                            << ", output size=" << m_output_samples.size()
+                            << ", votes=" << m_vote_count);
 
     return m_output_samples;
 }
@@ -8,42 +8,99 @@
 #ifndef VAD_H
 #define VAD_H
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <iostream>
+#include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
-struct WebRtcVadInst;
+#include "ring_buffer.hpp"
 
 class vad {
    public:
     using buf_t = std::vector<int16_t>;
 
+    enum class backend_t { webrtc, silero };
+    friend std::ostream& operator<<(std::ostream& os, backend_t backend);
+
+    struct config_t {
+        backend_t backend = backend_t::webrtc;
+        int webrtc_mode = 3;  // aggressiveness 0-3
+        std::string silero_model_file;
+        // chunks with lower peak are silence without running detector,
+        // 0 disables the gate
+        int energy_gate_peak = 0;
+        // speech starts when most of chunks in onset window are speech
+        unsigned int onset_ms = 750;
+        // speech ends after hangover of continuous silence
+        unsigned int hangover_ms = 300;
+    };
+
+    // classifies fixed-size chunks of 16kHz samples as speech or silence
+    class detector {
+       public:
+        virtual ~detector() = default;
+        virtual size_t chunk_size() const = 0;
+        virtual bool is_speech(const buf_t::value_type* chunk) = 0;
+        virtual void reset() = 0;
+    };
+
     struct voice_active_result {
         std::optional<size_t> start;
         std::optional<size_t> stop;
     };
 
     vad();
-    ~vad();
+    explicit vad(config_t config);
     void reset();
     void restart();
+    inline auto backend() const { return m_backend; }
+    void set_hangover(unsigned int hangover_ms);
+    // speech ended during last remove_silence call and didn't start again
+    inline auto speech_ended() const { return m_speech_ended; }
     const buf_t& remove_silence(const buf_t::value_type* frame, size_t frame_size);
     bool is_speech(const buf_t::value_type* frame, size_t frame_size);
 
    private:
-    inline static const size_t m_chunk_size = 480;
-    inline static const size_t m_dup_max_size = 10 * m_chunk_size;
-    inline static const size_t m_chunks_in_frame = 25;
-
-    WebRtcVadInst* m_handle = nullptr;
-    int m_mode = 3;
-    int m_fs = 16000;
-    buf_t m_input_samples;
+    inline static const size_t m_chunk_max_size = 512;
+    inline static const size_t m_window_max_chunks = 64;
+    // samples of onset window and one incomplete chunk
+    inline static const size_t m_history_size =
+        (m_window_max_chunks + 1) * m_chunk_max_size;
+
+    config_t m_config;
+    backend_t m_backend = backend_t::webrtc;
+    std::unique_ptr<detector> m_detector;
+    size_t m_chunk_size = 0;
+    // samples not yet classified as silence nor moved to output
+    ring_buffer<buf_t::value_type> m_history{m_history_size};
     buf_t m_output_samples;
-    size_t m_dup_size = 0;
+    // incomplete chunk waiting for classification
+    std::array<buf_t::value_type, m_chunk_max_size> m_chunk{};
+    size_t m_chunk_fill = 0;
+    // results of last chunks in onset window, m_vote_count is number of
+    // speech results
+    std::array<bool, m_window_max_chunks> m_votes{};
+    size_t m_window_chunks = 0;
+    size_t m_vote_idx = 0;
+    size_t m_vote_size = 0;
+    size_t m_vote_count = 0;
+    size_t m_hangover_chunks = 0;
+    // number of continuous silence chunks during speech
+    size_t m_silence_chunks = 0;
+    bool m_active = false;
+    bool m_speech_ended = false;
 
-    std::vector<bool> vad_process(const buf_t& samples) const;
+    void make_detector();
+    bool classify_chunk();
+    void push_vote(bool speech);
+    void clear_votes();
+    size_t duration_to_chunks(unsigned int duration_ms) const;
+    void process_chunk();
+    void move_history_to_output(size_t size);
     static void shift_left(std::vector<int16_t>& vec, size_t distance);
 };
 
@@ -15,7 +15,6 @@
 #include <unistd.h>
 
 #include <algorithm>
-#include <array>
 #include <chrono>
 
 #include "logger.hpp"
@@ -73,7 +72,6 @@ size_t du(const std::string& path) {
 vosk_engine::vosk_engine(config_t config, callbacks_t call_backs)
     : stt_engine{std::move(config), std::move(call_backs)} {
     open_vosk_lib();
-    m_speech_buf.reserve(m_speech_max_size);
 }
 
 vosk_engine::~vosk_engine() {
@@ -85,10 +83,10 @@ vosk_engine::~vosk_engine() {
         if (m_vosk_recognizer)
             m_vosk_api.vosk_recognizer_free(m_vosk_recognizer);
         m_vosk_recognizer = nullptr;
-        if (m_vosk_model) m_vosk_api.vosk_model_free(m_vosk_model);
-        m_vosk_model = nullptr;
     }
 
+    m_vosk_model.reset();
+
     m_vosk_api = {};
 
     if (m_vosklib_handle) {
@@ -125,6 +123,9 @@ void vosk_engine::open_vosk_lib() {
     m_vosk_api.vosk_recognizer_partial_result =
         reinterpret_cast<decltype(m_vosk_api.vosk_recognizer_partial_result)>(
             dlsym(m_vosklib_handle, "vosk_recognizer_partial_result"));
+    m_vosk_api.vosk_recognizer_result =
+        reinterpret_cast<decltype(m_vosk_api.vosk_recognizer_result)>(
+            dlsym(m_vosklib_handle, "vosk_recognizer_result"));
     m_vosk_api.vosk_recognizer_final_result =
         reinterpret_cast<decltype(m_vosk_api.vosk_recognizer_final_result)>(
             dlsym(m_vosklib_handle, "vosk_recognizer_final_result"));
@@ -140,12 +141,26 @@ void vosk_engine::start_processing_impl() {
     create_punctuator();
 }
 
-void vosk_engine::create_vosk_model() {
-    if (m_vosk_model) return;
+std::shared_ptr<VoskModel> vosk_engine::shared_vosk_model() {
+    const auto& model_file = m_config.model_files.model_file;
 
-    LOGD("creating vosk model");
+    auto find_model = [&]() -> std::shared_ptr<VoskModel> {
+        if (auto it = m_models.find(model_file); it != m_models.end())
+            return it->second.lock();
+        return {};
+    };
 
-    auto size = du(m_config.model_files.model_file);
+    {
+        std::lock_guard lock{m_models_mtx};
+        if (auto model = find_model()) {
+            LOGD("reusing vosk model: " << model_file);
+            return model;
+        }
+    }
+
+    // model is loaded without lock, so loading doesn't block engines using
+    // other models
+    auto size = du(model_file);
     LOGD("model size: " << size << " (max: " << model_max_size() << ")");
 
     if (size > model_max_size()) {
@@ -154,15 +169,52 @@ void vosk_engine::create_vosk_model() {
             "failed to create vosk model because it is too large");
     }
 
-    m_vosk_model =
-        m_vosk_api.vosk_model_new(m_config.model_files.model_file.c_str());
-    if (m_vosk_model == nullptr) {
+    auto* vosk_model = m_vosk_api.vosk_model_new(model_file.c_str());
+    if (vosk_model == nullptr) {
         LOGE("failed to create vosk model");
         throw std::runtime_error("failed to create vosk model");
     }
 
+    // lib handle is ref-counted by dlopen and every engine holding the model
+    // keeps it open, so free function stays valid in deleter
+    std::shared_ptr<VoskModel> model{
+        vosk_model, [model_free = m_vosk_api.vosk_model_free,
+                     model_file](VoskModel* ptr) {
+            LOGD("freeing vosk model: " << model_file);
+            model_free(ptr);
+        }};
+
+    std::lock_guard lock{m_models_mtx};
+
+    // the same model could be loaded by other engine in the meantime, model
+    // loaded here is freed after lock is released
+    if (auto other_model = find_model()) {
+        LOGD("reusing vosk model loaded concurrently: " << model_file);
+        return other_model;
+    }
+
+    // drop entries of already freed models
+    for (auto it = m_models.begin(); it != m_models.end();) {
+        if (it->second.expired())
+            it = m_models.erase(it);
+        else
+            ++it;
+    }
+
+    m_models.insert_or_assign(model_file, model);
+
+    return model;
+}
+
+void vosk_engine::create_vosk_model() {
+    if (m_vosk_model) return;
+
+    LOGD("creating vosk model");
+
+    m_vosk_model = shared_vosk_model();
+
     m_vosk_recognizer =
-        m_vosk_api.vosk_recognizer_new(m_vosk_model, m_sample_rate);
+        m_vosk_api.vosk_recognizer_new(m_vosk_model.get(), m_sample_rate);
     if (m_vosk_recognizer == nullptr) {
         LOGE("failed to create vosk recognizer");
         throw std::runtime_error("failed to create vosk recognizer");
@@ -171,82 +223,29 @@ void vosk_engine::create_vosk_model() {
     LOGD("vosk model created");
 }
 
-void vosk_engine::reset_impl() {
-    m_speech_buf.clear();
-
-#ifdef DUMP_AUDIO_TO_FILE
-    m_file_audio_input.reset();
-    m_file_audio_after_denoise.reset();
-    m_file_audio_after_vad.reset();
-#endif
-
-    if (m_vosk_recognizer) m_vosk_api.vosk_recognizer_reset(m_vosk_recognizer);
-}
-
-void vosk_engine::push_inbuf_to_samples() {
-    auto end = m_in_buf.buf.cbegin();
-    std::advance(end, m_in_buf.size);
-    m_speech_buf.insert(m_speech_buf.end(), m_in_buf.buf.cbegin(), end);
-}
+void vosk_engine::reset_impl() { reset_decoder(); }
 
 stt_engine::samples_process_result_t vosk_engine::process_buff() {
-    if (!lock_buff_for_processing())
-        return samples_process_result_t::wait_for_samples;
+    auto segment = pop_segment();
+    if (!segment) return samples_process_result_t::wait_for_samples;
 
-    auto eof = m_in_buf.eof;
-    auto sof = m_in_buf.sof;
+    auto eof = segment->eof;
+    auto sof = segment->sof;
 
     LOGD("process samples buf: mode="
-         << m_config.speech_mode << ", in-buf size=" << m_in_buf.size
-         << ", speech-buf size=" << m_speech_buf.size() << ", sof=" << sof
-         << ", eof=" << eof);
+         << m_config.speech_mode << ", segment size="
+         << segment->samples.size() << ", fed size=" << m_samples_fed
+         << ", sof=" << sof << ", eof=" << eof);
 
     if (sof) {
-        m_speech_buf.clear();
         m_start_time.reset();
-        m_vad.reset();
-
-        if (m_vosk_recognizer)
-            m_vosk_api.vosk_recognizer_reset(m_vosk_recognizer);
+        reset_decoder();
     }
 
-#ifdef DUMP_AUDIO_TO_FILE
-    if (!m_file_audio_input)
-        m_file_audio_input = std::make_unique<std::ofstream>("audio_input.pcm");
-    m_file_audio_input->write(
-        reinterpret_cast<char*>(m_in_buf.buf.data()),
-        m_in_buf.size * sizeof(decltype(m_in_buf.buf)::value_type));
-#endif
-
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
-
-#ifdef DUMP_AUDIO_TO_FILE
-    if (!m_file_audio_after_denoise)
-        m_file_audio_after_denoise =
-            std::make_unique<std::ofstream>("audio_after_denoise.pcm");
-    m_file_audio_after_denoise->write(
-        reinterpret_cast<char*>(m_in_buf.buf.data()),
-        m_in_buf.size * sizeof(decltype(m_in_buf.buf)::value_type));
-#endif
-
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
-
-#ifdef DUMP_AUDIO_TO_FILE
-    if (!m_file_audio_after_vad)
-        m_file_audio_after_vad =
-            std::make_unique<std::ofstream>("audio_after_vad.pcm");
-    m_file_audio_after_vad->write(
-        reinterpret_cast<const char*>(vad_buf.data()),
-        vad_buf.size() * sizeof(decltype(m_in_buf.buf)::value_type));
-#endif
-
-    m_in_buf.clear();
+    const auto& vad_buf = segment->samples;
 
     bool vad_status = !vad_buf.empty();
 
-    m_in_buf.clear();
-
     if (vad_status) {
         LOGD("vad: speech detected");
 
@@ -255,9 +254,6 @@ stt_engine::samples_process_result_t vosk_engine::process_buff() {
             set_speech_detection_status(
                 speech_detection_status_t::speech_detected);
 
-        m_speech_buf.insert(m_speech_buf.end(), vad_buf.cbegin(),
-                            vad_buf.cend());
-
         restart_sentence_timer();
     } else {
         LOGD("vad: no speech");
@@ -271,43 +267,45 @@ stt_engine::samples_process_result_t vosk_engine::process_buff() {
     }
 
     if (m_thread_exit_requested) {
-        free_buf();
         return samples_process_result_t::no_samples_needed;
     }
 
+    if (vad_status) {
+        set_processing_state(processing_state_t::decoding);
+
+        feed_speech(vad_buf);
+
+        if (m_config.speech_started)
+            set_processing_state(processing_state_t::idle);
+    }
+
+    // speech is finalized only on endpoint
     auto final_decode = [&] {
         if (eof) return true;
         if (m_config.speech_mode != speech_mode_t::manual &&
-            m_intermediate_text && !m_intermediate_text->empty() && !vad_status)
+            m_samples_fed > 0 && (!vad_status || segment->speech_end))
             return true;
         return false;
     }();
 
-    if (final_decode || !m_speech_buf.empty()) {
-        set_processing_state(processing_state_t::decoding);
-
-        LOGD("speech frame: samples=" << m_speech_buf.size()
-                                      << ", final=" << final_decode);
-
-        decode_speech(m_speech_buf, final_decode);
-
-        if (m_config.speech_started)
-            set_processing_state(processing_state_t::idle);
+    if (final_decode) {
+        LOGD("speech final decode: samples=" << m_samples_fed);
 
-        m_speech_buf.clear();
-
-        if (final_decode)
+        // noise without any words doesn't end the sentence
+        if (decode_final() || eof)
             flush(!eof && m_config.speech_mode == speech_mode_t::automatic
                       ? flush_t::regular
                       : flush_t::eof);
+    } else if (m_samples_fed >= m_samples_partial +
+                                    m_config.partial_interval_ms *
+                                        m_sample_rate / 1000) {
+        decode_partial();
     }
 
     if (!vad_status && !final_decode &&
         m_config.speech_mode == speech_mode_t::automatic)
         set_speech_detection_status(speech_detection_status_t::no_speech);
 
-    free_buf();
-
     return samples_process_result_t::wait_for_samples;
 }
 
@@ -327,52 +325,75 @@ std::string vosk_engine::get_from_json(const char* name, const char* str) {
     return {};
 }
 
-void vosk_engine::decode_speech(const vosk_buf_t& buf, bool eof) {
-    LOGD("speech decoding started");
+void vosk_engine::reset_decoder() {
+    if (m_vosk_recognizer) m_vosk_api.vosk_recognizer_reset(m_vosk_recognizer);
+
+    m_committed_text.clear();
+    m_samples_fed = 0;
+    m_samples_partial = 0;
+}
 
+void vosk_engine::feed_speech(const vosk_buf_t& buf) {
     auto ret = m_vosk_api.vosk_recognizer_accept_waveform_s(
-        m_vosk_recognizer, buf.data(), buf.size());
+        m_vosk_recognizer, buf.data(), static_cast<int>(buf.size()));
 
     if (ret < 0) {
         LOGE("error in vosk_recognizer_accept_waveform_s");
         return;
     }
 
-    if (ret == 0 && !eof) {
-        // append silence to force partial result
+    m_samples_fed += buf.size();
 
-        std::array<vosk_buf_t::value_type, m_in_buf_max_size> silence{};
+    if (ret == 1) {
+        // vosk detected end of utterance itself, its result must be taken
+        // before more audio is accepted
+        m_committed_text = join_texts(
+            m_committed_text,
+            get_from_json("text",
+                          m_vosk_api.vosk_recognizer_result(m_vosk_recognizer)));
 
-        auto ret = m_vosk_api.vosk_recognizer_accept_waveform_s(
-            m_vosk_recognizer, silence.data(), silence.size());
+        LOGD("vosk endpoint");
 
-        if (ret == 0) {
-            LOGD("no speech decoded");
-            return;
-        }
+        m_samples_partial = m_samples_fed;
+
+        set_decoded_text(m_committed_text);
     }
+}
 
-    auto result = [&] {
-        if (eof)
-            return get_from_json(
-                "text",
-                m_vosk_api.vosk_recognizer_final_result(m_vosk_recognizer));
+void vosk_engine::decode_partial() {
+    m_samples_partial = m_samples_fed;
 
-        return get_from_json(
+    set_decoded_text(join_texts(
+        m_committed_text,
+        get_from_json(
             "partial",
-            m_vosk_api.vosk_recognizer_partial_result(m_vosk_recognizer));
-    }();
+            m_vosk_api.vosk_recognizer_partial_result(m_vosk_recognizer))));
+}
+
+bool vosk_engine::decode_final() {
+    auto text = join_texts(
+        m_committed_text,
+        get_from_json(
+            "text", m_vosk_api.vosk_recognizer_final_result(m_vosk_recognizer)));
+
+    reset_decoder();
+
+    if (text.empty()) return false;
 
+    set_decoded_text(std::move(text));
+
+    return true;
+}
+
+void vosk_engine::set_decoded_text(std::string text) {
 #ifdef DEBUG
-    LOGD("speech decoded: text=" << result);
+    LOGD("speech decoded: text=" << text);
 #else
     LOGD("speech decoded");
 #endif
 
-    if (m_punctuator) result = m_punctuator->process(result);
-
-    if (!m_intermediate_text || m_intermediate_text != result)
-        set_intermediate_text(result);
+    if (m_punctuator) text = m_punctuator->process(text);
 
-    if (eof) m_vosk_api.vosk_recognizer_reset(m_vosk_recognizer);
+    if (!m_intermediate_text || m_intermediate_text != text)
+        set_intermediate_text(text);
 }
@@ -9,15 +9,12 @@
 #define VOSK_ENGINE_H
 
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#ifdef DUMP_AUDIO_TO_FILE
-#include <fstream>
-#include <memory>
-#endif
-
 #include "simdjson.h"
 #include "stt_engine.hpp"
 
@@ -42,6 +39,8 @@ class vosk_engine : public stt_engine {
         int (*vosk_recognizer_accept_waveform_s)(VoskRecognizer* recognizer,
                                                  const short* data,
                                                  int length) = nullptr;
+        const char* (*vosk_recognizer_result)(VoskRecognizer* recognizer) =
+            nullptr;
         const char* (*vosk_recognizer_partial_result)(
             VoskRecognizer* recognizer) = nullptr;
         const char* (*vosk_recognizer_final_result)(
@@ -51,33 +50,39 @@ class vosk_engine : public stt_engine {
             return vosk_model_new && vosk_model_free && vosk_recognizer_new &&
                    vosk_recognizer_reset && vosk_recognizer_free &&
                    vosk_recognizer_accept_waveform_s &&
-                   vosk_recognizer_partial_result &&
+                   vosk_recognizer_result && vosk_recognizer_partial_result &&
                    vosk_recognizer_final_result;
         }
     };
 
-    inline static const size_t m_speech_max_size = m_sample_rate * 60;  // 60s
-
-    vosk_buf_t m_speech_buf;
     vosk_api m_vosk_api;
     void* m_vosklib_handle = nullptr;
-    VoskModel* m_vosk_model = nullptr;
+    // model is shared between engines using the same model files, every
+    // engine has its own recognizer
+    std::shared_ptr<VoskModel> m_vosk_model;
+    inline static std::mutex m_models_mtx;
+    inline static std::unordered_map<std::string, std::weak_ptr<VoskModel>>
+        m_models;
     VoskRecognizer* m_vosk_recognizer = nullptr;
     simdjson::ondemand::parser m_parser;
-
-#ifdef DUMP_AUDIO_TO_FILE
-    std::unique_ptr<std::ofstream> m_file_audio_input;
-    std::unique_ptr<std::ofstream> m_file_audio_after_denoise;
-    std::unique_ptr<std::ofstream> m_file_audio_after_vad;
-#endif
+    // text of utterances finalized by vosk endpointing
+    std::string m_committed_text;
+    // samples accepted by recognizer since last final result
+    size_t m_samples_fed = 0;
+    // value of m_samples_fed when partial result was taken
+    size_t m_samples_partial = 0;
 
     void open_vosk_lib();
     void create_vosk_model();
+    std::shared_ptr<VoskModel> shared_vosk_model();
     samples_process_result_t process_buff() override;
-    void decode_speech(const vosk_buf_t& buf, bool eof);
+    void feed_speech(const vosk_buf_t& buf);
+    void decode_partial();
+    bool decode_final();
+    void set_decoded_text(std::string text);
+    void reset_decoder();
     void reset_impl() override;
     void start_processing_impl() override;
-    void push_inbuf_to_samples();
     std::string get_from_json(const char* name, const char* str);
 };
 
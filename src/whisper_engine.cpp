@@ -11,11 +11,13 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
-#include <sstream>
 
 #include "cpu_tools.hpp"
+#include "dsp_tools.hpp"
 #include "logger.hpp"
+#include "thread_tuner.hpp"
 
 whisper_engine::whisper_engine(config_t config, callbacks_t call_backs)
     : stt_engine{std::move(config), std::move(call_backs)} {
@@ -29,7 +31,15 @@ whisper_engine::~whisper_engine() {
 
     stop();
 
+    stop_workers();
+
     if (m_whisper_api.ok()) {
+        if (m_whisper_api.state_ok()) {
+            for (auto* state : m_whisper_states)
+                m_whisper_api.whisper_free_state(state);
+        }
+        m_whisper_states.clear();
+
         if (m_whisper_ctx) {
             m_whisper_api.whisper_free(m_whisper_ctx);
             m_whisper_ctx = nullptr;
@@ -176,6 +186,9 @@ void whisper_engine::open_whisper_lib() {
     m_whisper_api.whisper_full_get_segment_text =
         reinterpret_cast<decltype(m_whisper_api.whisper_full_get_segment_text)>(
             dlsym(m_whisperlib_handle, "whisper_full_get_segment_text"));
+    m_whisper_api.whisper_full_get_segment_t1 =
+        reinterpret_cast<decltype(m_whisper_api.whisper_full_get_segment_t1)>(
+            dlsym(m_whisperlib_handle, "whisper_full_get_segment_t1"));
     m_whisper_api.whisper_free =
         reinterpret_cast<decltype(m_whisper_api.whisper_free)>(
             dlsym(m_whisperlib_handle, "whisper_free"));
@@ -187,25 +200,62 @@ void whisper_engine::open_whisper_lib() {
         LOGE("failed to register whisper api");
         throw std::runtime_error("failed to register whisper api");
     }
+
+    m_whisper_api.whisper_init_state =
+        reinterpret_cast<decltype(m_whisper_api.whisper_init_state)>(
+            dlsym(m_whisperlib_handle, "whisper_init_state"));
+    m_whisper_api.whisper_free_state =
+        reinterpret_cast<decltype(m_whisper_api.whisper_free_state)>(
+            dlsym(m_whisperlib_handle, "whisper_free_state"));
+    m_whisper_api.whisper_full_with_state =
+        reinterpret_cast<decltype(m_whisper_api.whisper_full_with_state)>(
+            dlsym(m_whisperlib_handle, "whisper_full_with_state"));
+    m_whisper_api.whisper_full_n_segments_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_n_segments_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_n_segments_from_state"));
+    m_whisper_api.whisper_full_get_segment_text_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_get_segment_text_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_get_segment_text_from_state"));
+    m_whisper_api.whisper_full_get_segment_t1_from_state = reinterpret_cast<
+        decltype(m_whisper_api.whisper_full_get_segment_t1_from_state)>(
+        dlsym(m_whisperlib_handle, "whisper_full_get_segment_t1_from_state"));
+
+    if (!m_whisper_api.state_ok())
+        LOGW("whisper state api not available, parallel decoding disabled");
+
+    if (m_config.streaming && !m_whisper_api.whisper_full_get_segment_t1) {
+        LOGW("whisper segment timestamps not available, streaming disabled");
+        m_streaming_available = false;
+    }
 }
 
 void whisper_engine::push_buf_to_whisper_buf(
     const std::vector<in_buf_t::buf_t::value_type>& buf,
     whisper_buf_t& whisper_buf) {
     // convert s16 to f32 sample format
-    std::transform(buf.cbegin(), buf.cend(), std::back_inserter(whisper_buf),
-                   [](auto sample) {
-                       return static_cast<whisper_buf_t::value_type>(sample) /
-                              32768.0F;
-                   });
+    auto offset = whisper_buf.size();
+    whisper_buf.resize(offset + buf.size());
+    dsp_tools::s16_to_f32(buf.data(), whisper_buf.data() + offset, buf.size());
 }
 
-void whisper_engine::reset_impl() { m_speech_buf.clear(); }
+void whisper_engine::reset_impl() {
+    m_speech_buf.clear();
+    stop_workers();
+}
 
 void whisper_engine::stop_processing_impl() {
     if (m_whisper_ctx) {
         LOGD("whisper cancel");
     }
+
+    // flag is set under the same mutex as results are waited on, otherwise
+    // waiter could check it just before it is set and miss notification
+    {
+        std::lock_guard lock{m_jobs_mtx};
+        m_thread_exit_requested = true;
+    }
+
+    m_results_cv.notify_all();
 }
 
 void whisper_engine::start_processing_impl() { create_whisper_model(); }
@@ -224,32 +274,54 @@ void whisper_engine::create_whisper_model() {
     }
 
     LOGD("whisper model created");
+
+    if (!m_config.use_gpu) {
+        m_wparams.n_threads = thread_tuner::instance()->threads(
+            m_config.model_files.model_file, m_wparams.n_threads,
+            [this](int threads) { return bench_threads(threads); });
+
+        LOGD("using threads: " << m_wparams.n_threads << "/"
+                               << std::thread::hardware_concurrency());
+    }
+}
+
+bool whisper_engine::bench_threads(int threads) {
+    // 2s of quiet synthetic tone
+    whisper_buf_t buf(m_sample_rate * 2);
+    for (size_t i = 0; i < buf.size(); ++i)
+        buf[i] = 0.01F * std::sin(static_cast<float>(i) * 0.05F);
+
+    auto params = m_wparams;
+    params.n_threads = threads;
+    params.audio_ctx = audio_ctx_for_samples(buf.size());
+
+    return m_whisper_api.whisper_full(m_whisper_ctx, params, buf.data(),
+                                      static_cast<int>(buf.size())) == 0;
 }
 
 stt_engine::samples_process_result_t whisper_engine::process_buff() {
-    if (!lock_buff_for_processing())
-        return samples_process_result_t::wait_for_samples;
+    auto parallel = parallel_decoding_enabled();
+
+    if (parallel) commit_decode_results(false);
 
-    auto eof = m_in_buf.eof;
-    auto sof = m_in_buf.sof;
+    auto segment = pop_segment();
+    if (!segment) return samples_process_result_t::wait_for_samples;
+
+    auto eof = segment->eof;
+    auto sof = segment->sof;
 
     LOGD("process samples buf: mode="
-         << m_config.speech_mode << ", in-buf size=" << m_in_buf.size
-         << ", speech-buf size=" << m_speech_buf.size() << ", sof=" << sof
-         << ", eof=" << eof);
+         << m_config.speech_mode << ", segment size="
+         << segment->samples.size() << ", speech-buf size="
+         << m_speech_buf.size() << ", sof=" << sof << ", eof=" << eof);
 
     if (sof) {
         m_speech_buf.clear();
+        m_streaming.reset();
         m_start_time.reset();
-        m_vad.reset();
     }
 
-    m_denoiser.process(m_in_buf.buf.data(), m_in_buf.size);
-
-    const auto& vad_buf =
-        m_vad.remove_silence(m_in_buf.buf.data(), m_in_buf.size);
-
-    m_in_buf.clear();
+    const auto& vad_buf = segment->samples;
 
     bool vad_status = !vad_buf.empty();
 
@@ -288,7 +360,7 @@ stt_engine::samples_process_result_t whisper_engine::process_buff() {
         if ((m_config.speech_mode == speech_mode_t::manual ||
              m_speech_detection_status ==
                  speech_detection_status_t::speech_detected) &&
-            vad_status && !eof)
+            vad_status && !segment->speech_end && !eof)
             return false;
 
         if ((m_config.speech_mode == speech_mode_t::manual ||
@@ -300,21 +372,40 @@ stt_engine::samples_process_result_t whisper_engine::process_buff() {
         return true;
     }();
 
+    if (parallel) {
+        if (decode_samples) {
+            LOGD("speech frame queued: samples=" << m_speech_buf.size());
+
+            submit_decode_job(std::move(m_speech_buf), segment->end_pos);
+            m_speech_buf.clear();
+        } else if (m_speech_buf.empty() && m_next_result_id == m_next_job_id) {
+            m_samples_committed = segment->end_pos;
+        }
+
+        if (eof) {
+            commit_decode_results(true);
+            flush(flush_t::eof);
+            return samples_process_result_t::no_samples_needed;
+        }
+
+        return samples_process_result_t::wait_for_samples;
+    }
+
     if (!decode_samples) {
         if (eof || (m_config.speech_mode == speech_mode_t::manual &&
                     m_speech_detection_status ==
                         speech_detection_status_t::no_speech)) {
             flush(eof ? flush_t::eof : flush_t::regular);
-            free_buf();
             return samples_process_result_t::no_samples_needed;
         }
 
-        free_buf();
+        if (vad_status && streaming_decode_due(m_speech_buf.size()))
+            decode_partial_speech();
+
         return samples_process_result_t::wait_for_samples;
     }
 
     if (m_thread_exit_requested) {
-        free_buf();
         return samples_process_result_t::no_samples_needed;
     }
 
@@ -342,8 +433,6 @@ stt_engine::samples_process_result_t whisper_engine::process_buff() {
               ? flush_t::eof
               : flush_t::regular);
 
-    free_buf();
-
     return samples_process_result_t::wait_for_samples;
 }
 
@@ -399,30 +488,8 @@ void whisper_engine::decode_speech(const whisper_buf_t& buf) {
 
     auto decoding_start = std::chrono::steady_clock::now();
 
-    std::ostringstream os;
-
-    if (auto ret = m_whisper_api.whisper_full(m_whisper_ctx, m_wparams,
-                                              buf.data(), buf.size());
-        ret == 0) {
-        auto n = m_whisper_api.whisper_full_n_segments(m_whisper_ctx);
-        LOGD("decoded segments: " << n);
-
-        for (auto i = 0; i < n; ++i) {
-            std::string text =
-                m_whisper_api.whisper_full_get_segment_text(m_whisper_ctx, i);
-            rtrim(text);
-            ltrim(text);
-#ifdef DEBUG
-            LOGD("segment " << i << ": " << text);
-#endif
-            if (i != 0) os << ' ';
-
-            os << text;
-        }
-    } else {
-        LOGE("whisper error: " << ret);
-        return;
-    }
+    auto text = decode_text(nullptr, m_wparams, buf);
+    if (!text) return;
 
     if (m_thread_exit_requested) return;
 
@@ -437,7 +504,10 @@ void whisper_engine::decode_speech(const whisper_buf_t& buf) {
          << ")");
 
     auto result =
-        merge_texts(m_intermediate_text.value_or(std::string{}), os.str());
+        streaming_enabled()
+            ? m_streaming.finish(std::move(*text))
+            : merge_texts(m_intermediate_text.value_or(std::string{}),
+                          std::move(*text));
 
 #ifdef DEBUG
     LOGD("speech decoded: text=" << result);
@@ -446,3 +516,306 @@ void whisper_engine::decode_speech(const whisper_buf_t& buf) {
     if (!m_intermediate_text || m_intermediate_text != result)
         set_intermediate_text(result);
 }
+
+void whisper_engine::decode_partial_speech() {
+    LOGD("partial speech decoding started: samples=" << m_speech_buf.size());
+
+    set_processing_state(processing_state_t::decoding);
+
+    create_whisper_model();
+
+    auto segments = decode_segments(nullptr, m_wparams, m_speech_buf);
+
+    set_processing_state(processing_state_t::idle);
+
+    if (!segments || m_thread_exit_requested) return;
+
+    m_streaming.decoded_size = m_speech_buf.size();
+
+    // when window gets too long, everything except last segment is committed
+    // to keep amount of work per decode bounded
+    auto trim =
+        std::min(m_streaming.commit(std::move(*segments),
+                                    m_speech_buf.size() > m_streaming_max_window),
+                 m_speech_buf.size());
+
+    if (trim > 0) {
+        LOGD("committed samples trimmed: " << trim);
+        m_speech_buf.erase(m_speech_buf.begin(),
+                           m_speech_buf.begin() + static_cast<long>(trim));
+    }
+
+    auto text = m_streaming.text();
+
+#ifdef DEBUG
+    LOGD("partial speech decoded: text=" << text);
+#endif
+
+    if (!m_intermediate_text || m_intermediate_text != text)
+        set_intermediate_text(text);
+}
+
+std::optional<std::string> whisper_engine::decode_text(
+    whisper_state* state, const whisper_full_params& wparams,
+    const whisper_buf_t& buf) {
+    auto segments = decode_segments(state, wparams, buf);
+    if (!segments) return std::nullopt;
+
+    std::string text;
+    for (const auto& segment : *segments) text = join_texts(text, segment.text);
+
+    return text;
+}
+
+std::optional<std::vector<stt_engine::segment_t>>
+whisper_engine::decode_segments(whisper_state* state,
+                                const whisper_full_params& wparams,
+                                const whisper_buf_t& buf) {
+    auto params = wparams;
+    params.audio_ctx = audio_ctx_for_samples(buf.size());
+
+    LOGD("audio ctx: " << params.audio_ctx);
+
+    auto ret = state ? m_whisper_api.whisper_full_with_state(
+                           m_whisper_ctx, state, params, buf.data(),
+                           static_cast<int>(buf.size()))
+                     : m_whisper_api.whisper_full(m_whisper_ctx, params,
+                                                  buf.data(), buf.size());
+    if (ret != 0) {
+        LOGE("whisper error: " << ret);
+        return std::nullopt;
+    }
+
+    auto n = state ? m_whisper_api.whisper_full_n_segments_from_state(state)
+                   : m_whisper_api.whisper_full_n_segments(m_whisper_ctx);
+    LOGD("decoded segments: " << n);
+
+    std::vector<segment_t> segments;
+    segments.reserve(n);
+
+    for (auto i = 0; i < n; ++i) {
+        std::string text =
+            state ? m_whisper_api.whisper_full_get_segment_text_from_state(
+                        state, i)
+                  : m_whisper_api.whisper_full_get_segment_text(m_whisper_ctx,
+                                                                i);
+        rtrim(text);
+        ltrim(text);
+#ifdef DEBUG
+        LOGD("segment " << i << ": " << text);
+#endif
+        if (text.empty()) continue;
+
+        // segment timestamps are in 10 ms units
+        int64_t t1 = -1;
+        if (state && m_whisper_api.whisper_full_get_segment_t1_from_state)
+            t1 = m_whisper_api.whisper_full_get_segment_t1_from_state(state, i);
+        else if (!state && m_whisper_api.whisper_full_get_segment_t1)
+            t1 = m_whisper_api.whisper_full_get_segment_t1(m_whisper_ctx, i);
+
+        auto end = t1 < 0 ? buf.size()
+                          : std::min(buf.size(), static_cast<size_t>(t1) *
+                                                     m_sample_rate / 100);
+
+        segments.push_back({std::move(text), end});
+    }
+
+    return segments;
+}
+
+int whisper_engine::audio_ctx_for_samples(size_t samples) const {
+    // encoder always works on 30s window (1500 frames), limiting its context
+    // to the actual speech length makes decoding of short speech much faster
+    if (!m_config.adaptive_audio_ctx) return 0;
+
+    auto frames = static_cast<int>(
+        ((samples + m_audio_ctx_margin) * m_audio_ctx_max +
+         m_audio_ctx_window - 1) /
+        m_audio_ctx_window);
+
+    return frames >= m_audio_ctx_max ? 0 : frames;
+}
+
+size_t whisper_engine::parallel_states_count() const {
+    // gpu memory is usually too small to hold many states
+    if (m_config.use_gpu) return 1;
+
+    return std::clamp<size_t>(
+        std::thread::hardware_concurrency() / m_min_threads_per_state, 1,
+        m_max_parallel_states);
+}
+
+int whisper_engine::threads_per_state() const {
+    return std::clamp(static_cast<int>(std::thread::hardware_concurrency() /
+                                       parallel_states_count()),
+                      1, m_wparams.n_threads);
+}
+
+bool whisper_engine::parallel_decoding_enabled() const {
+    return offline_mode() && m_whisper_api.state_ok() &&
+           parallel_states_count() > 1;
+}
+
+size_t whisper_engine::samples_processed() const {
+    if (parallel_decoding_enabled()) return m_samples_committed;
+    return stt_engine::samples_processed();
+}
+
+void whisper_engine::start_workers() {
+    if (!m_workers.empty()) return;
+
+    create_whisper_model();
+
+    auto count = parallel_states_count();
+
+    while (m_whisper_states.size() < count) {
+        auto* state = m_whisper_api.whisper_init_state(m_whisper_ctx);
+        if (state == nullptr) {
+            LOGE("failed to create whisper state");
+            break;
+        }
+        m_whisper_states.push_back(state);
+    }
+
+    if (m_whisper_states.empty())
+        throw std::runtime_error("failed to create whisper state");
+
+    m_workers_exit_requested = false;
+
+    for (auto* state : m_whisper_states)
+        m_workers.emplace_back(&whisper_engine::worker_loop, this, state);
+
+    LOGD("parallel decoding started: workers=" << m_workers.size()
+                                               << ", threads per worker="
+                                               << threads_per_state());
+}
+
+void whisper_engine::stop_workers() {
+    if (!m_workers.empty()) {
+        {
+            std::lock_guard lock{m_jobs_mtx};
+            m_workers_exit_requested = true;
+        }
+
+        m_jobs_cv.notify_all();
+
+        for (auto& worker : m_workers)
+            if (worker.joinable()) worker.join();
+
+        m_workers.clear();
+
+        LOGD("parallel decoding stopped");
+    }
+
+    m_jobs.clear();
+    m_results.clear();
+    m_next_job_id = 0;
+    m_next_result_id = 0;
+    m_samples_committed = 0;
+}
+
+void whisper_engine::worker_loop(whisper_state* state) {
+    auto wparams = m_wparams;
+    wparams.n_threads = threads_per_state();
+
+    while (true) {
+        decode_job_t job;
+
+        {
+            std::unique_lock lock{m_jobs_mtx};
+            m_jobs_cv.wait(lock, [this] {
+                return m_workers_exit_requested || !m_jobs.empty();
+            });
+
+            if (m_workers_exit_requested) break;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        LOGD("decode job started: id=" << job.id
+                                       << ", samples=" << job.samples.size());
+
+        decode_result_t result;
+        result.end_pos = job.end_pos;
+        if (!m_thread_exit_requested)
+            result.text = decode_text(state, wparams, job.samples);
+
+        LOGD("decode job finished: id=" << job.id);
+
+        {
+            std::lock_guard lock{m_jobs_mtx};
+            m_results.emplace(job.id, std::move(result));
+        }
+
+        m_results_cv.notify_all();
+        notify_processing();
+    }
+}
+
+void whisper_engine::submit_decode_job(whisper_buf_t&& buf, size_t end_pos) {
+    start_workers();
+
+    set_processing_state(processing_state_t::decoding);
+
+    // limit number of speech chunks kept in memory
+    const auto max_jobs = 2 * m_workers.size();
+
+    while (true) {
+        commit_decode_results(false);
+
+        std::unique_lock lock{m_jobs_mtx};
+
+        if (m_thread_exit_requested ||
+            m_next_job_id - m_next_result_id < max_jobs) {
+            m_jobs.push_back({m_next_job_id++, std::move(buf), end_pos});
+            break;
+        }
+
+        m_results_cv.wait(lock, [this] {
+            return m_thread_exit_requested ||
+                   m_results.count(m_next_result_id) > 0;
+        });
+    }
+
+    m_jobs_cv.notify_one();
+}
+
+void whisper_engine::commit_decode_results(bool wait_for_all) {
+    // results are committed in the same order as jobs were submitted
+    while (true) {
+        decode_result_t result;
+
+        {
+            std::unique_lock lock{m_jobs_mtx};
+
+            if (wait_for_all)
+                m_results_cv.wait(lock, [this] {
+                    return m_thread_exit_requested ||
+                           m_next_result_id == m_next_job_id ||
+                           m_results.count(m_next_result_id) > 0;
+                });
+
+            auto it = m_results.find(m_next_result_id);
+            if (it == m_results.end()) break;
+
+            result = std::move(it->second);
+            m_results.erase(it);
+            ++m_next_result_id;
+        }
+
+        m_samples_committed = result.end_pos;
+
+        if (result.text && !result.text->empty()) {
+#ifdef DEBUG
+            LOGD("speech decoded: text=" << *result.text);
+#endif
+            set_intermediate_text(*result.text);
+            flush(flush_t::regular);
+        }
+    }
+
+    set_processing_state(m_next_result_id == m_next_job_id
+                             ? processing_state_t::idle
+                             : processing_state_t::decoding);
+}
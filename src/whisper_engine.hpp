@@ -10,8 +10,14 @@
 
 #include <whisper.h>
 
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "stt_engine.hpp"
@@ -30,6 +36,13 @@ class whisper_engine : public stt_engine {
 
     inline static const size_t m_speech_max_size = m_sample_rate * 60;  // 60s
     inline static const int m_threads = 5;
+    inline static const size_t m_max_parallel_states = 4;
+    inline static const size_t m_min_threads_per_state = 4;
+    inline static const int m_audio_ctx_max = 1500;
+    inline static const size_t m_audio_ctx_window = m_sample_rate * 30;  // 30s
+    inline static const size_t m_audio_ctx_margin = m_sample_rate;  // 1s
+    inline static const size_t m_streaming_max_window =
+        m_sample_rate * 25;  // 25s
 
     struct whisper_api {
         whisper_context* (*whisper_init_from_file)(const char* path_model) =
@@ -40,15 +53,48 @@ class whisper_engine : public stt_engine {
         int (*whisper_full_n_segments)(whisper_context* ctx) = nullptr;
         const char* (*whisper_full_get_segment_text)(whisper_context* ctx,
                                                      int i_segment) = nullptr;
+        int64_t (*whisper_full_get_segment_t1)(whisper_context* ctx,
+                                               int i_segment) = nullptr;
         void (*whisper_free)(whisper_context* ctx) = nullptr;
         whisper_full_params (*whisper_full_default_params)(
             whisper_sampling_strategy strategy) = nullptr;
+        whisper_state* (*whisper_init_state)(whisper_context* ctx) = nullptr;
+        void (*whisper_free_state)(whisper_state* state) = nullptr;
+        int (*whisper_full_with_state)(whisper_context* ctx,
+                                       whisper_state* state,
+                                       whisper_full_params params,
+                                       const float* samples,
+                                       int n_samples) = nullptr;
+        int (*whisper_full_n_segments_from_state)(whisper_state* state) =
+            nullptr;
+        const char* (*whisper_full_get_segment_text_from_state)(
+            whisper_state* state, int i_segment) = nullptr;
+        int64_t (*whisper_full_get_segment_t1_from_state)(
+            whisper_state* state, int i_segment) = nullptr;
         inline auto ok() const {
             return whisper_init_from_file && whisper_print_system_info &&
                    whisper_full && whisper_full_n_segments &&
                    whisper_full_get_segment_text && whisper_free &&
                    whisper_full_default_params;
         }
+        inline auto state_ok() const {
+            return whisper_init_state && whisper_free_state &&
+                   whisper_full_with_state &&
+                   whisper_full_n_segments_from_state &&
+                   whisper_full_get_segment_text_from_state;
+        }
+    };
+
+    // speech chunk decoded in offline mode on one of worker states
+    struct decode_job_t {
+        size_t id = 0;
+        whisper_buf_t samples;
+        size_t end_pos = 0;
+    };
+
+    struct decode_result_t {
+        std::optional<std::string> text;
+        size_t end_pos = 0;
     };
 
     whisper_buf_t m_speech_buf;
@@ -57,10 +103,40 @@ class whisper_engine : public stt_engine {
     whisper_context* m_whisper_ctx = nullptr;
     whisper_full_params m_wparams{};
 
+    std::vector<whisper_state*> m_whisper_states;
+    std::vector<std::thread> m_workers;
+    std::mutex m_jobs_mtx;
+    std::condition_variable m_jobs_cv;
+    std::condition_variable m_results_cv;
+    std::deque<decode_job_t> m_jobs;
+    std::map<size_t, decode_result_t> m_results;
+    size_t m_next_job_id = 0;
+    size_t m_next_result_id = 0;
+    bool m_workers_exit_requested = false;
+    std::atomic_size_t m_samples_committed = 0;
+
     void open_whisper_lib();
     void create_whisper_model();
+    bool bench_threads(int threads);
     samples_process_result_t process_buff() override;
     void decode_speech(const whisper_buf_t& buf);
+    void decode_partial_speech();
+    std::optional<std::string> decode_text(whisper_state* state,
+                                           const whisper_full_params& wparams,
+                                           const whisper_buf_t& buf);
+    std::optional<std::vector<segment_t>> decode_segments(
+        whisper_state* state, const whisper_full_params& wparams,
+        const whisper_buf_t& buf);
+    int audio_ctx_for_samples(size_t samples) const;
+    size_t parallel_states_count() const;
+    int threads_per_state() const;
+    bool parallel_decoding_enabled() const;
+    void start_workers();
+    void stop_workers();
+    void worker_loop(whisper_state* state);
+    void submit_decode_job(whisper_buf_t&& buf, size_t end_pos);
+    void commit_decode_results(bool wait_for_all);
+    size_t samples_processed() const override;
     static void push_buf_to_whisper_buf(
         const std::vector<in_buf_t::buf_t::value_type>& buf,
         whisper_buf_t& whisper_buf);
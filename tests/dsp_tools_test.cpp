@@ -0,0 +1,137 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+#include "dsp_tools.hpp"
+
+static std::vector<dsp_tools::simd_t> supported_simds() {
+    std::vector<dsp_tools::simd_t> simds;
+
+    for (auto simd : {dsp_tools::simd_t::sse2, dsp_tools::simd_t::avx2,
+                      dsp_tools::simd_t::neon})
+        if (dsp_tools::simd_supported(simd)) simds.push_back(simd);
+
+    return simds;
+}
+
+static std::vector<int16_t> make_s16_samples(size_t size) {
+    std::vector<int16_t> samples(size);
+
+    for (size_t i = 0; i < size; ++i)
+        samples[i] = static_cast<int16_t>((i * 7919) % 65536 - 32768);
+
+    // edge values and odd size to exercise scalar tail
+    samples[0] = -32768;
+    samples[1] = 32767;
+    samples[size - 1] = -32768;
+
+    return samples;
+}
+
+static std::vector<float> make_f32_samples(size_t size) {
+    std::vector<float> samples(size);
+
+    for (size_t i = 0; i < size; ++i)
+        samples[i] = static_cast<float>(static_cast<int>(i % 301) - 150) / 100.0F;
+
+    return samples;
+}
+
+TEST_CASE("dsp_tools", "[simd]") {
+    auto initial_simd = dsp_tools::simd();
+
+    const size_t size = 1001;
+    auto s16 = make_s16_samples(size);
+    auto f32 = make_f32_samples(size);
+
+    REQUIRE(dsp_tools::set_simd(dsp_tools::simd_t::none));
+
+    std::vector<float> f32_ref(size);
+    dsp_tools::s16_to_f32(s16.data(), f32_ref.data(), size);
+    std::vector<int16_t> s16_ref(size);
+    dsp_tools::f32_to_s16(f32.data(), s16_ref.data(), size);
+    auto peak_ref = dsp_tools::peak(s16.data(), size);
+    auto gain_ref = s16;
+    dsp_tools::apply_gain_q10(gain_ref.data(), size, 3000);
+
+    REQUIRE(f32_ref[0] == -1.0F);
+    REQUIRE(s16_ref[0] == -32768);
+    REQUIRE(peak_ref == 32768);
+    REQUIRE(gain_ref[1] == 32767);
+
+    for (auto simd : supported_simds()) {
+        INFO("simd: " << simd);
+
+        REQUIRE(dsp_tools::set_simd(simd));
+        REQUIRE(dsp_tools::simd() == simd);
+
+        std::vector<float> f32_out(size);
+        dsp_tools::s16_to_f32(s16.data(), f32_out.data(), size);
+        REQUIRE(f32_out == f32_ref);
+
+        std::vector<int16_t> s16_out(size);
+        dsp_tools::f32_to_s16(f32.data(), s16_out.data(), size);
+        REQUIRE(s16_out == s16_ref);
+
+        REQUIRE(dsp_tools::peak(s16.data(), size) == peak_ref);
+
+        auto gain_out = s16;
+        dsp_tools::apply_gain_q10(gain_out.data(), size, 3000);
+        REQUIRE(gain_out == gain_ref);
+    }
+
+    dsp_tools::set_simd(initial_simd);
+}
+
+TEST_CASE("dsp_tools", "[.][benchmark]") {
+    auto initial_simd = dsp_tools::simd();
+
+    // 1s of 16kHz audio
+    const size_t size = 16000;
+    auto s16 = make_s16_samples(size);
+    auto f32 = make_f32_samples(size);
+    std::vector<float> f32_out(size);
+    std::vector<int16_t> s16_out(size);
+
+    auto simds = supported_simds();
+    simds.insert(simds.begin(), dsp_tools::simd_t::none);
+
+    for (auto simd : simds) {
+        dsp_tools::set_simd(simd);
+
+        std::ostringstream os;
+        os << simd;
+        auto name = os.str();
+
+        BENCHMARK("s16_to_f32 " + name) {
+            dsp_tools::s16_to_f32(s16.data(), f32_out.data(), size);
+            return f32_out.back();
+        };
+
+        BENCHMARK("f32_to_s16 " + name) {
+            dsp_tools::f32_to_s16(f32.data(), s16_out.data(), size);
+            return s16_out.back();
+        };
+
+        BENCHMARK("peak " + name) {
+            return dsp_tools::peak(s16.data(), size);
+        };
+
+        BENCHMARK("apply_gain_q10 " + name) {
+            s16_out = s16;
+            dsp_tools::apply_gain_q10(s16_out.data(), size, 1500);
+            return s16_out.back();
+        };
+    }
+
+    dsp_tools::set_simd(initial_simd);
+}
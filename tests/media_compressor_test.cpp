@@ -0,0 +1,125 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "media_compressor.hpp"
+
+// 44.1kHz stereo s16 wav, so that both downmix and resampling are needed
+static std::string make_wav_file(const std::string& name, int duration_s) {
+    const uint32_t sample_rate = 44100;
+    const uint16_t channels = 2;
+    const uint32_t data_size = duration_s * sample_rate * channels * 2;
+
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+
+    std::ofstream file{path, std::ios::binary};
+
+    auto write = [&](auto value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    file.write("RIFF", 4);
+    write(uint32_t{36 + data_size});
+    file.write("WAVEfmt ", 8);
+    write(uint32_t{16});
+    write(uint16_t{1});
+    write(channels);
+    write(sample_rate);
+    write(uint32_t{sample_rate * channels * 2});
+    write(uint16_t{channels * 2});
+    write(uint16_t{16});
+    file.write("data", 4);
+    write(data_size);
+
+    std::vector<int16_t> frame(channels);
+    for (uint32_t i = 0; i < data_size / (channels * 2); ++i) {
+        frame[0] = static_cast<int16_t>(8000 * std::sin(i * 0.0627));
+        frame[1] = static_cast<int16_t>(8000 * std::sin(i * 0.0911));
+        file.write(reinterpret_cast<const char*>(frame.data()),
+                   frame.size() * sizeof(int16_t));
+    }
+
+    return path;
+}
+
+static size_t decompress_to_raw(const std::string& path,
+                                media_compressor::resampler_t resampler) {
+    media_compressor mc;
+    mc.set_resampler(resampler);
+    mc.decompress_to_raw_async({path}, /*mono_16khz=*/true, {}, {});
+
+    std::vector<char> buf(65536);
+    size_t total = 0;
+
+    while (true) {
+        auto info = mc.get_data(buf.data(), buf.size());
+        total += info.size;
+        if (info.eof) break;
+        if (info.size == 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    REQUIRE_FALSE(mc.error());
+
+    return total;
+}
+
+TEST_CASE("media_compressor", "[resampler]") {
+    const int duration_s = 10;
+    auto path = make_wav_file("dsnote_resampler_test.wav", duration_s);
+
+    // 16kHz mono s16, resampler may add or drop few samples at the edges
+    const size_t expected_size = duration_s * 16000 * 2;
+
+    for (auto resampler : {media_compressor::resampler_t::swr_fast,
+                           media_compressor::resampler_t::swr_medium,
+                           media_compressor::resampler_t::swr_high,
+                           media_compressor::resampler_t::filter_graph}) {
+        INFO("resampler: " << resampler);
+
+        auto size = decompress_to_raw(path, resampler);
+
+        REQUIRE(size % 2 == 0);
+        REQUIRE(size > expected_size - 1000);
+        REQUIRE(size < expected_size + 1000);
+    }
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("media_compressor", "[.][benchmark]") {
+    // filter_graph is conversion used before swr, so the same binary gives
+    // before and after figures, run with: tests "[benchmark]"
+    // long input, 10 min
+    auto path = make_wav_file("dsnote_resampler_bench.wav", 600);
+
+    for (auto resampler : {media_compressor::resampler_t::filter_graph,
+                           media_compressor::resampler_t::swr_fast,
+                           media_compressor::resampler_t::swr_medium,
+                           media_compressor::resampler_t::swr_high}) {
+        std::ostringstream os;
+        os << resampler;
+
+        BENCHMARK("decompress_to_raw " + os.str()) {
+            return decompress_to_raw(path, resampler);
+        };
+    }
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,110 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "ring_buffer.hpp"
+
+TEST_CASE("ring_buffer", "[basic]") {
+    ring_buffer<int16_t> rb{5};
+
+    SECTION("capacity rounded to power of two") {
+        REQUIRE(rb.capacity() == 8);
+        REQUIRE(rb.empty());
+        REQUIRE(rb.free_size() == 8);
+    }
+
+    SECTION("write and read") {
+        std::vector<int16_t> in{1, 2, 3};
+        REQUIRE(rb.write(in.data(), in.size()) == 3);
+        REQUIRE(rb.size() == 3);
+
+        std::vector<int16_t> out(3);
+        REQUIRE(rb.read(out.data(), out.size()) == 3);
+        REQUIRE(out == in);
+        REQUIRE(rb.empty());
+    }
+
+    SECTION("write more than capacity") {
+        std::vector<int16_t> in(10, 7);
+        REQUIRE(rb.write(in.data(), in.size()) == 8);
+        REQUIRE(rb.full());
+        REQUIRE(rb.write_region().second == 0);
+    }
+
+    SECTION("wrap around") {
+        std::vector<int16_t> in{1, 2, 3, 4, 5, 6};
+        std::vector<int16_t> out(6);
+
+        rb.write(in.data(), in.size());
+        rb.read(out.data(), 4);
+        rb.write(in.data(), in.size());
+
+        // contiguous region ends at the end of storage
+        REQUIRE(rb.read_region().second == 4);
+
+        REQUIRE(rb.read(out.data(), out.size()) == 6);
+        REQUIRE(out == std::vector<int16_t>{5, 6, 1, 2, 3, 4});
+        REQUIRE(rb.size() == 2);
+    }
+
+    SECTION("high water mark") {
+        std::vector<int16_t> in{1, 2, 3, 4, 5, 6};
+        std::vector<int16_t> out(6);
+
+        rb.write(in.data(), 6);
+        rb.read(out.data(), 6);
+        rb.write(in.data(), 2);
+
+        REQUIRE(rb.high_water_mark() == 6);
+
+        rb.reset_high_water_mark();
+        REQUIRE(rb.high_water_mark() == 2);
+    }
+
+    SECTION("clear") {
+        std::vector<int16_t> in{1, 2, 3};
+        rb.write(in.data(), in.size());
+        rb.clear();
+
+        REQUIRE(rb.empty());
+        REQUIRE(rb.free_size() == rb.capacity());
+    }
+}
+
+TEST_CASE("ring_buffer_spsc", "[spsc]") {
+    ring_buffer<uint32_t> rb{1024};
+    const uint32_t count = 1000000;
+
+    std::thread producer{[&] {
+        uint32_t next = 0;
+        while (next < count) {
+            auto [ptr, size] = rb.write_region();
+            size_t n = 0;
+            for (; n < size && next < count; ++n) ptr[n] = next++;
+            rb.commit_write(n);
+        }
+    }};
+
+    bool ordered = true;
+    uint32_t expected = 0;
+    while (expected < count) {
+        auto [ptr, size] = rb.read_region();
+        for (size_t i = 0; i < size; ++i)
+            if (ptr[i] != expected++) ordered = false;
+        rb.commit_read(size);
+    }
+
+    producer.join();
+
+    REQUIRE(ordered);
+    REQUIRE(rb.empty());
+    REQUIRE(rb.high_water_mark() <= rb.capacity());
+}
@@ -41,3 +41,54 @@ TEST_CASE("stt_engine", "[merge_texts]") {
         REQUIRE(result == "Hello, How are you");
     }
 }
+
+TEST_CASE("stt_engine", "[streaming]") {
+    stt_engine::streaming_state_t streaming;
+    streaming.decoded_size = 300;
+
+    SECTION("first decode commits nothing") {
+        auto trim = streaming.commit({{"Hello.", 100}, {"How are", 200}}, false);
+
+        REQUIRE(trim == 0);
+        REQUIRE(streaming.committed_text.empty());
+        REQUIRE(streaming.text() == "Hello. How are");
+    }
+
+    SECTION("stable segments are committed and trimmed") {
+        streaming.commit({{"Hello.", 100}, {"How are", 200}}, false);
+        auto trim = streaming.commit(
+            {{"Hello.", 100}, {"How are you?", 250}, {"Fine", 300}}, false);
+
+        REQUIRE(trim == 100);
+        REQUIRE(streaming.committed_text == "Hello.");
+        REQUIRE(streaming.decoded_size == 200);
+        REQUIRE(streaming.pending_segments.size() == 2);
+        REQUIRE(streaming.pending_segments[0].end == 150);
+        REQUIRE(streaming.text() == "Hello. How are you? Fine");
+    }
+
+    SECTION("last segment is never committed") {
+        streaming.commit({{"Hello.", 100}}, false);
+        auto trim = streaming.commit({{"Hello.", 100}}, true);
+
+        REQUIRE(trim == 0);
+        REQUIRE(streaming.committed_text.empty());
+    }
+
+    SECTION("forced commit") {
+        auto trim = streaming.commit({{"Hello.", 100}, {"How are", 200}}, true);
+
+        REQUIRE(trim == 100);
+        REQUIRE(streaming.committed_text == "Hello.");
+    }
+
+    SECTION("finish") {
+        streaming.commit({{"Hello.", 100}, {"How are", 200}}, true);
+        auto result = streaming.finish("How are you?");
+
+        REQUIRE(result == "Hello. How are you?");
+        REQUIRE(streaming.committed_text.empty());
+        REQUIRE(streaming.pending_segments.empty());
+        REQUIRE(streaming.decoded_size == 0);
+    }
+}
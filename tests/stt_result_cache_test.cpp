@@ -0,0 +1,116 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <catch2/catch_test_macros.hpp>
+
+#include "stt_result_cache.hpp"
+
+static QString make_file(const QTemporaryDir& dir, const QString& name,
+                         const QByteArray& data) {
+    auto path = dir.filePath(name);
+
+    QFile file{path};
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+
+    return path;
+}
+
+TEST_CASE("stt_result_cache", "[key]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    QByteArray data(1024, 'a');
+    auto file = make_file(dir, "a.wav", data);
+    auto other_file = make_file(dir, "b.wav", data);
+
+    auto key = stt_result_cache::make_key(file, "model");
+
+    REQUIRE_FALSE(key.isEmpty());
+
+    SECTION("same file and params give the same key") {
+        REQUIRE(stt_result_cache::make_key(file, "model") == key);
+    }
+
+    SECTION("different params give different key") {
+        REQUIRE(stt_result_cache::make_key(file, "other model") != key);
+    }
+
+    SECTION("different file gives different key") {
+        REQUIRE(stt_result_cache::make_key(other_file, "model") != key);
+    }
+
+    SECTION("modified file gives different key") {
+        QFile modified{file};
+        REQUIRE(modified.open(QIODevice::ReadWrite));
+        auto mtime = modified.fileTime(QFileDevice::FileModificationTime);
+        modified.seek(data.size() / 2);
+        modified.write("b", 1);
+        modified.flush();
+        // content is not read, only modification time differs
+        modified.setFileTime(mtime.addSecs(1),
+                             QFileDevice::FileModificationTime);
+        modified.close();
+
+        REQUIRE(stt_result_cache::make_key(file, "model") != key);
+    }
+
+    SECTION("missing file gives empty key") {
+        REQUIRE(stt_result_cache::make_key(dir.filePath("missing.wav"),
+                                           "model")
+                    .isEmpty());
+    }
+}
+
+TEST_CASE("stt_result_cache", "[lru]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    auto cache_dir = dir.filePath("cache");
+    auto text = QString(40, 'x');
+
+    // room for two entries
+    stt_result_cache cache{cache_dir, 150};
+
+    cache.put("key1", {text});
+    cache.put("key2", {text});
+
+    REQUIRE(cache.stats().entries == 2);
+    REQUIRE(cache.get("key1") == QStringList{text});
+
+    // key2 is least recently used
+    cache.put("key3", {text});
+
+    REQUIRE(cache.stats().entries == 2);
+    REQUIRE(cache.stats().size <= 150);
+    REQUIRE_FALSE(cache.get("key2"));
+    REQUIRE(cache.get("key1"));
+    REQUIRE(cache.get("key3"));
+    REQUIRE_FALSE(QFile::exists(QDir{cache_dir}.filePath("key2.json")));
+
+    REQUIRE(cache.stats().hits == 3);
+    REQUIRE(cache.stats().misses == 1);
+
+    SECTION("entries are loaded from disk") {
+        stt_result_cache other_cache{cache_dir, 150};
+
+        REQUIRE(other_cache.stats().entries == 2);
+        REQUIRE(other_cache.get("key1") == QStringList{text});
+    }
+
+    SECTION("entry bigger than limit is not kept") {
+        cache.put("key4", {QString(200, 'y')});
+
+        REQUIRE_FALSE(cache.get("key4"));
+        REQUIRE(cache.stats().size <= 150);
+    }
+}
@@ -0,0 +1,92 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "thread_tuner.hpp"
+
+TEST_CASE("thread_tuner", "[candidates]") {
+    REQUIRE(thread_tuner::candidates(1) == std::vector<int>{1});
+    REQUIRE(thread_tuner::candidates(4) == std::vector<int>{1, 2, 3, 4});
+    REQUIRE(thread_tuner::candidates(6) == std::vector<int>{2, 4, 6});
+    REQUIRE(thread_tuner::candidates(32) ==
+            std::vector<int>{2, 4, 8, 16, 32});
+}
+
+TEST_CASE("thread_tuner", "[model_id]") {
+    REQUIRE(thread_tuner::model_id("/models/en_whisper_base.ggml") ==
+            "en_whisper_base.ggml");
+    REQUIRE(thread_tuner::model_id("/models/en_de_bergamot/") ==
+            "en_de_bergamot");
+    REQUIRE(thread_tuner::model_id("model") == "model");
+}
+
+TEST_CASE("thread_tuner", "[calibration]") {
+    auto cache_file = std::string{"thread_tuner_test.cache"};
+    std::remove(cache_file.c_str());
+
+    auto* tuner = thread_tuner::instance();
+    tuner->set_cache_file(cache_file);
+    tuner->set_max_threads(4);
+
+    // bench is fastest with 2 threads if there are enough cores
+    auto expected = std::thread::hardware_concurrency() >= 2 ? 2 : 1;
+
+    int runs = 0;
+    auto bench = [&](int threads) {
+        ++runs;
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(threads == 2 ? 5 : 30));
+        return true;
+    };
+
+    REQUIRE(tuner->threads("/models/model_a", 1, bench) == expected);
+    REQUIRE(runs > 0);
+
+    SECTION("cached value is used") {
+        runs = 0;
+        REQUIRE(tuner->threads("/other/dir/model_a", 1, bench) == expected);
+        REQUIRE(runs == 0);
+    }
+
+    SECTION("cached value is persisted") {
+        tuner->set_cache_file(cache_file);
+        REQUIRE(tuner->cached_threads("/models/model_a") == expected);
+    }
+
+    SECTION("prepare is not measured") {
+        auto prepare = [](int threads) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(threads == 2 ? 50 : 0));
+            return true;
+        };
+
+        REQUIRE(tuner->threads("/models/model_c", 1, prepare, bench) ==
+                expected);
+    }
+
+    SECTION("failed prepare returns default") {
+        REQUIRE(tuner->threads(
+                    "/models/model_d", 1, [](int) { return false; },
+                    bench) == 1);
+        REQUIRE_FALSE(tuner->cached_threads("/models/model_d"));
+    }
+
+    SECTION("failed calibration returns default") {
+        REQUIRE(tuner->threads("/models/model_b", 1,
+                               [](int) { return false; }) == 1);
+        REQUIRE_FALSE(tuner->cached_threads("/models/model_b"));
+    }
+
+    tuner->set_cache_file({});
+    tuner->set_max_threads(0);
+    std::remove(cache_file.c_str());
+}
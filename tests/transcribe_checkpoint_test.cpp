@@ -0,0 +1,80 @@
+/* Copyright (C) 2023 Michal Kosciesza <michal@mkiol.net>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <QByteArray>
+#include <QFile>
+#include <QTemporaryDir>
+#include <catch2/catch_test_macros.hpp>
+
+#include "transcribe_checkpoint.hpp"
+
+TEST_CASE("transcribe_checkpoint", "[resume]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    auto checkpoint_dir = dir.filePath("checkpoints");
+    auto file = dir.filePath("audio.wav");
+    // checkpoint is identified by everything that has impact on decoded text
+    QString params{"model, translate=0"};
+
+    {
+        QFile audio{file};
+        audio.open(QIODevice::WriteOnly);
+        audio.write(QByteArray(1024, 'a'));
+    }
+
+    {
+        transcribe_checkpoint checkpoint{checkpoint_dir, file, params};
+
+        REQUIRE(checkpoint.offset_ms() == 0);
+        REQUIRE(checkpoint.texts().isEmpty());
+
+        checkpoint.add_text("first", 1000);
+        checkpoint.add_text("second", 2500);
+        checkpoint.save();
+    }
+
+    SECTION("saved progress is loaded") {
+        transcribe_checkpoint checkpoint{checkpoint_dir, file, params};
+
+        REQUIRE(checkpoint.offset_ms() == 2500);
+        REQUIRE(checkpoint.texts() == QStringList{"first", "second"});
+
+        // decoded time is counted from offset of resumed task
+        checkpoint.add_text("third", 500);
+        REQUIRE(checkpoint.offset_ms() == 3000);
+    }
+
+    SECTION("other engine params don't use checkpoint") {
+        transcribe_checkpoint checkpoint{checkpoint_dir, file,
+                                         "model, translate=1"};
+
+        REQUIRE(checkpoint.offset_ms() == 0);
+        REQUIRE(checkpoint.texts().isEmpty());
+    }
+
+    SECTION("checkpoint of modified file is discarded") {
+        {
+            QFile audio{file};
+            audio.open(QIODevice::Append);
+            audio.write(QByteArray(16, 'b'));
+        }
+
+        transcribe_checkpoint checkpoint{checkpoint_dir, file, params};
+
+        REQUIRE(checkpoint.offset_ms() == 0);
+        REQUIRE(checkpoint.texts().isEmpty());
+    }
+
+    SECTION("removed checkpoint is not loaded") {
+        transcribe_checkpoint{checkpoint_dir, file, params}.remove();
+
+        transcribe_checkpoint checkpoint{checkpoint_dir, file, params};
+
+        REQUIRE(checkpoint.offset_ms() == 0);
+    }
+}
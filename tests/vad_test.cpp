@@ -7,7 +7,12 @@
 
 #define private public
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <optional>
 #include <string>
 
 #include "vad.hpp"
@@ -33,3 +38,150 @@ TEST_CASE("vad", "[shift_left]") {
         REQUIRE(buf.empty());
     }
 }
+
+static std::vector<int16_t> make_samples(size_t size) {
+    std::vector<int16_t> samples(size, 0);
+
+    // 1s of noise every 2s
+    uint32_t seed = 1;
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        if ((i / 16000) % 2 == 1)
+            samples[i] = static_cast<int16_t>((seed >> 16) % 16000 - 8000);
+    }
+
+    return samples;
+}
+
+static std::vector<int16_t> remove_silence(vad& v,
+                                           const std::vector<int16_t>& samples,
+                                           size_t frame_size) {
+    std::vector<int16_t> output;
+
+    for (size_t i = 0; i < samples.size(); i += frame_size) {
+        const auto& buf = v.remove_silence(
+            samples.data() + i, std::min(frame_size, samples.size() - i));
+        output.insert(output.end(), buf.cbegin(), buf.cend());
+    }
+
+    return output;
+}
+
+TEST_CASE("vad", "[remove_silence]") {
+    vad v;
+
+    SECTION("silence") {
+        std::vector<int16_t> samples(16000 * 5, 0);
+
+        REQUIRE(remove_silence(v, samples, 4000).empty());
+    }
+
+    SECTION("result doesn't depend on frame size") {
+        auto samples = make_samples(16000 * 10);
+
+        auto output = remove_silence(v, samples, samples.size());
+
+        REQUIRE(output.size() <= samples.size());
+
+        for (size_t frame_size : {100, 480, 1000, 3200, 8000}) {
+            v.restart();
+            REQUIRE(remove_silence(v, samples, frame_size) == output);
+        }
+    }
+}
+
+TEST_CASE("vad", "[backend]") {
+    SECTION("webrtc is default") {
+        vad v;
+
+        REQUIRE(v.backend() == vad::backend_t::webrtc);
+    }
+
+    SECTION("fallback to webrtc when silero model is missing") {
+        vad::config_t config;
+        config.backend = vad::backend_t::silero;
+        config.silero_model_file = "/nonexistent/silero_vad.onnx";
+
+        vad v{config};
+
+        REQUIRE(v.backend() == vad::backend_t::webrtc);
+        REQUIRE(v.m_chunk_size == 480);
+    }
+
+    SECTION("energy gate skips quiet chunks") {
+        vad::config_t config;
+        config.energy_gate_peak = 20000;
+
+        vad v{config};
+
+        auto samples = make_samples(16000 * 4);
+
+        REQUIRE(remove_silence(v, samples, 3200).empty());
+    }
+}
+
+// speech when mean amplitude is high, makes results predictable
+class energy_detector : public vad::detector {
+   public:
+    size_t chunk_size() const override { return 480; }
+    bool is_speech(const vad::buf_t::value_type* chunk) override {
+        long sum = 0;
+        for (size_t i = 0; i < chunk_size(); ++i) sum += std::abs(chunk[i]);
+        return sum / static_cast<long>(chunk_size()) > 1000;
+    }
+    void reset() override {}
+};
+
+TEST_CASE("vad", "[endpoint]") {
+    vad::config_t config;
+    config.onset_ms = 300;
+    config.hangover_ms = 300;
+
+    vad v{config};
+    v.m_detector = std::make_unique<energy_detector>();
+    v.reset();
+
+    // 1s silence, 1s noise, 2s silence
+    auto samples = make_samples(16000 * 4);
+    std::fill(samples.begin() + 16000 * 2, samples.end(), 0);
+
+    const size_t frame_size = 160;
+    std::optional<size_t> speech_start;
+    std::optional<size_t> speech_end;
+
+    for (size_t i = 0; i < samples.size(); i += frame_size) {
+        const auto& buf = v.remove_silence(samples.data() + i, frame_size);
+
+        if (!speech_start && !buf.empty()) speech_start = i + frame_size;
+        if (v.speech_ended()) {
+            REQUIRE_FALSE(speech_end);
+            speech_end = i + frame_size;
+        }
+    }
+
+    REQUIRE(speech_start);
+    REQUIRE(speech_end);
+
+    // majority of 300ms onset window
+    REQUIRE(*speech_start >= 16000 + 160 * 16);
+    REQUIRE(*speech_start <= 16000 + 160 * 16 + 480 + frame_size);
+
+    // end decided on chunk boundary after 300ms of silence
+    REQUIRE(*speech_end >= 32000 + 4800);
+    REQUIRE(*speech_end <= 32000 + 4800 + 480 + frame_size);
+}
+
+TEST_CASE("vad", "[.][benchmark]") {
+    vad v;
+
+    // 200 ms of 16kHz audio, same as mic buffer
+    auto samples = make_samples(16000 * 4);
+    const size_t frame_size = 3200;
+    size_t offset = 0;
+
+    BENCHMARK("remove_silence") {
+        const auto& buf = v.remove_silence(samples.data() + offset, frame_size);
+        offset = (offset + frame_size) % samples.size();
+        return buf.size();
+    };
+}